@@ -0,0 +1,790 @@
+// Throughput of the drawing kernels against a CpuFrameBuffer, without SDL or a display.
+//
+// usage: drawing-benchmark [--csv] [--resolutions=640x360,1920x1080] [--min-seconds=0.2] [--kernels=avx2]
+//
+// --kernels chooses which instruction set's drawing kernels to measure (scalar, sse4.1, avx2, avx512bw or neon),
+// instead of the fastest the CPU supports; the ones used are printed to stderr. First, every set of kernels the CPU
+// supports draws the same random sprites, scans the same random rows for opaque pixels, intersects the same random
+// packets of rays with shapes, and evaluates noise and gradient lookups at the same random points, which must give the
+// same results as the scalar kernels, and drawDepthVolume must draw the same with each blender's SIMD version as with its
+// scalar callback, otherwise the exit code is 1.
+//
+// That check is the only test that the kernels of each instruction set are equivalent, and it only covers the sets the
+// CPU running it supports (whatever --kernels or DRAWING_KERNELS choose). To check kernels the CPU lacks, run it under
+// an emulator which reports them, e.g. Intel SDE for AVX-512: sde64 -skx -- drawing-benchmark
+//
+// Sprite kernels are measured for each resolution, sprite density (sprite pixels per screen pixel)
+// and clip case (sprites entirely inside the screen, straddling its edges, or entirely outside it).
+// Each case is repeated until min-seconds have passed (at least 3 times) and the fastest repetition is reported,
+// as JSON (one object per line inside an array) or CSV.
+//
+// pixels are the source pixels left after clipping; bytes are a nominal count of memory traffic per pixel:
+//   fillFast: 4 (argb) or 2 (depth) written
+//   clear: 6 written (argb + depth)
+//   copyFrom: 6 read + 6 written, restoring a frame buffer from another (like a static background layer)
+//   scroll: 6 read + 6 written, moving a frame buffer's contents by a few pixels (like a panning static layer)
+//   drawWithoutDepth: 4 read + 4 written
+//   drawWithDepth: 4 read (source) + 2 read (depth) + 4 + 2 written
+//   drawDepthVolume: 2 read (source) + 2 + 4 read (depth, argb) + 2 + 4 written
+//   drawDepthVolume add: the same with blending::AddArgbConst1, with its vector blend or (per pixel) without
+//   interleaved8/16: the same kernels drawing to CpuInterleavedFrameBuffer with blocks of 8 or 16 pixels
+//   interleaved resolve: 4 read + 4 written
+//   clear + drawWithDepth: a whole frame, clear (6 per screen pixel) then drawWithDepth, eagerly or lazily cleared,
+//     and for the interleaved layouts resolved (8 per screen pixel) as presenting would have to
+//   Orthogonal::render: 4 written
+
+// C++ standard library
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// third party
+#include <glm/glm.hpp>
+
+// utility
+#include "Fnv1a.hpp"
+#include "Stopwatch.hpp"
+
+// this project
+#include "CpuDepthVolume.hpp"
+#include "CpuFrameBuffer.hpp"
+#include "CpuImageWithDepth.hpp"
+#include "CpuInterleavedFrameBuffer.hpp"
+#include "CpuSparseImageWithDepth.hpp"
+#include "drawing/blending/BlendArgbConst1.hpp"
+#include "drawing/blending/MixArgb.hpp"
+#include "drawing/clip.hpp"
+#include "drawing/drawDepthVolume.hpp"
+#include "drawing/drawSparseWithDepth.hpp"
+#include "drawing/drawWithDepth.hpp"
+#include "drawing/drawWithoutDepth.hpp"
+#include "drawing/interleaved.hpp"
+#include "drawing/kernels/active.hpp"
+#include "raycasting/cameras/Orthogonal.hpp"
+#include "raycasting/shapes/makeSphere.hpp"
+
+namespace
+{
+  constexpr int spriteSize = 128;
+  constexpr float densities[] = {0.5f, 2.f, 8.f};
+
+  enum class Clip {inside, edges, outside};
+  constexpr Clip clips[] = {Clip::inside, Clip::edges, Clip::outside};
+
+  const char *
+  clipName(Clip clip) {return clip == Clip::inside ? "inside" : clip == Clip::edges ? "edges" : "outside";}
+
+  struct Options
+  {
+    bool csv{false};
+    std::vector<glm::ivec2> resolutions{{640, 360}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+    double minSeconds{0.2};
+    std::string kernels; // empty for the default
+  };
+
+  struct Result
+  {
+    std::string kernel;
+    int w, h;
+    float density; // 0 if not applicable
+    const char *clip; // "" if not applicable
+    int64_t sprites, pixels, bytes; // per repetition
+    int repetitions;
+    double seconds; // fastest repetition
+  };
+
+  class Report
+  {
+  public:
+    explicit Report(bool csv) : csv{csv}
+    {
+      if (csv)
+        std::cout << "kernel,width,height,density,clip,sprites,pixels,bytes,repetitions,seconds,pixelsPerSecond,gigabytesPerSecond,spritesPerSecond" << std::endl;
+      else
+        std::cout << "[" << std::endl;
+    }
+
+    ~Report()
+    {
+      if (!csv)
+        std::cout << std::endl << "]" << std::endl;
+    }
+
+    void add(const Result &r)
+    {
+      const double pixelsPerSecond = (double)r.pixels / r.seconds;
+      const double gigabytesPerSecond = (double)r.bytes / r.seconds * 1e-9;
+      const double spritesPerSecond = (double)r.sprites / r.seconds;
+
+      std::ostringstream line;
+      line.precision(6);
+
+      if (csv)
+        line
+          << r.kernel << "," << r.w << "," << r.h << "," << r.density << "," << r.clip << ","
+          << r.sprites << "," << r.pixels << "," << r.bytes << "," << r.repetitions << "," << r.seconds << ","
+          << pixelsPerSecond << "," << gigabytesPerSecond << "," << spritesPerSecond;
+      else
+        line
+          << (first ? "" : ",\n")
+          << "  {\"kernel\": \"" << r.kernel << "\", \"width\": " << r.w << ", \"height\": " << r.h
+          << ", \"density\": " << r.density << ", \"clip\": \"" << r.clip << "\""
+          << ", \"sprites\": " << r.sprites << ", \"pixels\": " << r.pixels << ", \"bytes\": " << r.bytes
+          << ", \"repetitions\": " << r.repetitions << ", \"seconds\": " << r.seconds
+          << ", \"pixelsPerSecond\": " << pixelsPerSecond << ", \"gigabytesPerSecond\": " << gigabytesPerSecond
+          << ", \"spritesPerSecond\": " << spritesPerSecond << "}";
+
+      std::cout << line.str() << (csv ? "\n" : "") << std::flush;
+      first = false;
+    }
+
+  private:
+    const bool csv;
+    bool first{true};
+  };
+
+  // Calls setup() then run() until minSeconds have passed (at least 3 times); returns the fastest run() in seconds.
+  double
+  measure(double minSeconds, int *repetitions, auto &&setup, auto &&run)
+  {
+    auto seconds = [](const Stopwatch &stopwatch) {return std::chrono::duration<double>(stopwatch.d).count();};
+
+    Stopwatch total;
+    total.start();
+
+    double best = 1e30;
+    int n = 0;
+
+    for (; n < 3 || (total.stop(), seconds(total) < minSeconds); ++n)
+    {
+      setup();
+
+      Stopwatch stopwatch;
+      stopwatch.start();
+      run();
+      stopwatch.stop();
+
+      best = std::min(best, seconds(stopwatch));
+    }
+
+    *repetitions = n;
+    return std::max(best, 1e-9);
+  }
+
+  // opaque disc with a hemisphere of depth, transparent outside
+  void
+  makeDiscImage(const ViewOfCpuImageWithDepth &image)
+  {
+    const float r = (float)image.w * 0.5f;
+
+    for (int y = 0; y < image.h; ++y)
+      for (int x = 0; x < image.w; ++x)
+      {
+        const float dx = (float)x + 0.5f - r, dy = (float)y + 0.5f - r;
+        const float sq = 1.f - (dx * dx + dy * dy) / (r * r);
+
+        if (sq <= 0.f)
+          image.drgb[y * image.pitch + x] = 0xff000000;
+        else
+        {
+          const auto depth = uint32_t(127.f - 120.f * glm::sqrt(sq));
+          image.drgb[y * image.pitch + x] = depth << 24 | uint32_t(x * 2) << 16 | uint32_t(y * 2) << 8 | 0x80;
+        }
+      }
+  }
+
+  // the depth volume of a sphere, as raycasting::volumes::makeSphere would produce
+  void
+  makeSphereVolume(const ViewOfCpuDepthVolume &volume)
+  {
+    const float r = (float)volume.w * 0.5f;
+
+    for (int y = 0; y < volume.h; ++y)
+      for (int x = 0; x < volume.w; ++x)
+      {
+        const float dx = (float)x + 0.5f - r, dy = (float)y + 0.5f - r;
+        const float sq = 1.f - (dx * dx + dy * dy) / (r * r);
+        const float halfThickness = sq > 0.f ? 120.f * glm::sqrt(sq) : 0.f;
+        const auto thickness = (uint16_t)std::min(255.f, 2.f * halfThickness);
+
+        volume.depthAndThickness[y * volume.w + x] = thickness == 0 ? 0 : uint16_t(thickness << 8 | uint16_t(127.f - halfThickness));
+      }
+  }
+
+  struct Placement
+  {
+    int x, y;
+    int16_t bias;
+  };
+
+  // deterministic sprite positions for a clip case, with enough sprites to cover density times the screen
+  std::vector<Placement>
+  placeSprites(int w, int h, float density, Clip clip)
+  {
+    std::minstd_rand random{12345};
+    auto uniform = [&](int min, int max) {return std::uniform_int_distribution<int>{min, max}(random);};
+
+    const int n = std::max(1, int(density * float(w) * float(h) / float(spriteSize * spriteSize)));
+
+    std::vector<Placement> placements;
+    placements.reserve(n);
+
+    for (int i = 0; i < n; ++i)
+    {
+      Placement p{.bias = (int16_t)uniform(-64, 64)};
+
+      switch (clip)
+      {
+      case Clip::inside:
+        (p.x = uniform(0, std::max(0, w - spriteSize)), p.y = uniform(0, std::max(0, h - spriteSize)));
+        break;
+      case Clip::edges: // centered on a random point of the screen border
+        if (uniform(0, 1))
+          (p.x = uniform(0, 1) ? -spriteSize / 2 : w - spriteSize / 2, p.y = uniform(-spriteSize / 2, h - spriteSize / 2));
+        else
+          (p.x = uniform(-spriteSize / 2, w - spriteSize / 2), p.y = uniform(0, 1) ? -spriteSize / 2 : h - spriteSize / 2);
+        break;
+      case Clip::outside:
+        (p.x = uniform(0, 1) ? -spriteSize - uniform(0, w) : w + uniform(0, w), p.y = uniform(-spriteSize, h));
+        break;
+      }
+
+      placements.push_back(p);
+    }
+
+    return placements;
+  }
+
+  int64_t
+  clippedPixels(int w, int h, const std::vector<Placement> &placements)
+  {
+    using namespace drawing;
+
+    int64_t pixels = 0;
+
+    for (const Placement &p: placements)
+      pixels += int64_t(std::max(0, clipMax(p.x, w, spriteSize) - clipMin(p.x, w, spriteSize)))
+        * std::max(0, clipMax(p.y, h, spriteSize) - clipMin(p.y, h, spriteSize));
+
+    return pixels;
+  }
+
+  // Checksum of the frame buffers after drawing random sprites of awkward sizes at random places (some clipped) with
+  // every drawing function which uses the drawing kernels, the pixels written that they count, the opaque pixels the
+  // kernels find in random rows, and what the packet kernels give for random packets of rays through random shapes,
+  // noise at random points and gradient lookups of random t, NaN and t outside [0, 1] included.
+  // Depth biases are small enough that no depth overflows int16, where the SIMD kernels saturate and scalar wraps.
+  uint64_t
+  drawRandomSprites()
+  {
+    constexpr int w = 203, h = 117;
+    std::minstd_rand random{7};
+    auto uniform = [&](int min, int max) {return std::uniform_int_distribution<int>{min, max}(random);};
+
+    CpuFrameBuffer frameBuffer{w, h};
+    CpuInterleavedFrameBuffer<8> interleavedFrameBuffer{w, h};
+    std::vector<uint32_t> resolved(w * h);
+    drawing::DrawStats stats;
+
+    Fnv1a checksum;
+    auto add = [&](uint32_t v) {checksum.add(v);};
+
+    frameBuffer.useWith(
+      [&](const ViewOfCpuFrameBuffer &dest)
+      {
+        interleavedFrameBuffer.useWith(
+          [&](const ViewOfCpuInterleavedFrameBuffer<8> &interleavedDest)
+          {
+            dest.clear(0xff000000, 300);
+            interleavedDest.clear(0xff000000, 300);
+
+            for (int i = 0; i < 200; ++i)
+            {
+              const int spriteW = uniform(1, 90), spriteH = uniform(1, 20);
+              const int x = uniform(-spriteW, w), y = uniform(-spriteH, h);
+              const auto bias = (int16_t)uniform(-64, 64);
+
+              CpuImageWithDepth image{spriteW, spriteH};
+              CpuDepthVolume volume{spriteW, spriteH};
+
+              for (int j = 0; j < spriteW * spriteH; ++j)
+              {
+                image.getUnsafeView().drgb[j] = uniform(0, 2) ? (uint32_t)random() % 0xff000000u : 0xff000000u | (uint32_t)random();
+                volume.getUnsafeView().depthAndThickness[j] = uniform(0, 2) ? (uint16_t)random() : (uint16_t)uniform(0, 255);
+              }
+
+              image.measureMinDepth();
+
+              switch (i % 6)
+              {
+              case 0: drawing::drawWithDepth(dest, x, y, image.getUnsafeView(), bias, &stats); break;
+              case 1: drawing::drawSparseWithDepth(dest, x, y, CpuSparseImageWithDepth{image.getUnsafeView()}.getUnsafeView(), bias, &stats); break;
+              case 2: drawing::drawWithoutDepth(dest, x, y, image.getUnsafeView()); break;
+              case 3: drawing::drawDepthVolume(dest, x, y, volume.getUnsafeView(), bias, drawing::blending::MixArgbConst1{(uint32_t)random()}); break;
+              case 4: drawing::drawWithDepth(interleavedDest, x, y, image.getUnsafeView(), bias, &stats); break;
+              case 5: drawing::drawDepthVolume(interleavedDest, x, y, volume.getUnsafeView(), bias, drawing::blending::MixArgbConst1{(uint32_t)random()}); break;
+              }
+            }
+
+            interleavedDest.resolve(resolved.data(), w);
+
+            // a fill of an odd length at an odd address, over what has been drawn
+            drawing::kernels::active().fillArgb(dest.image + 1, w * 3 + 5, 0xff123456);
+            drawing::kernels::active().fillDepth(dest.depth + 3, w * 2 + 7, 1234);
+          });
+
+        for (int i = 0; i < w * h; ++i)
+          (add(dest.image[i]), add((uint16_t)dest.depth[i]), add(resolved[i]));
+
+      });
+
+    add((uint32_t)stats.pixelsWritten);
+
+    // the first and last opaque pixels of random ranges of rows with from none to many opaque pixels
+    std::vector<uint32_t> row(w);
+
+    for (int i = 0; i < 300; ++i)
+    {
+      const int sparsity = uniform(0, 300);
+
+      for (uint32_t &pixel: row)
+        pixel = uniform(0, sparsity) ? 0xff000000u | (uint32_t)random() : uniform(0, 1) ? 0xfeffffffu : (uint32_t)random() % 0xff000000u;
+
+      const int begin = uniform(0, w), end = uniform(begin, w);
+      add((uint32_t)drawing::kernels::active().firstOpaque(row.data(), begin, end));
+      add((uint32_t)drawing::kernels::active().lastOpaque(row.data(), begin, end));
+    }
+
+    // The packet kernels round alike for every instruction set (see kernels/Float8.hpp), so every lane they write is
+    // added, bit for bit. Any NaN is added as the same value: which one an operation gives can depend on the order of
+    // its operands, which the compiler may swap.
+    auto real = [&](float min, float max) {return std::uniform_real_distribution<float>{min, max}(random);};
+    auto addFloats = [&](const std::array<float, 8> &lanes)
+    {
+      for (float lane: lanes)
+        add(std::isnan(lane) ? 0x7fc00000u : std::bit_cast<uint32_t>(lane));
+    };
+
+    // packets of 8 rays with random origins and a shared random direction through random spheres, quads and cones
+    std::array<float, 8> ox, oy, oz, px, py, pz, nx, ny, nz, distance;
+    const drawing::kernels::IntersectionLanes intersections{
+      .px = px.data(), .py = py.data(), .pz = pz.data(), .nx = nx.data(), .ny = ny.data(), .nz = nz.data(), .distance = distance.data()};
+
+    for (int i = 0; i < 300; ++i)
+    {
+      float dx = real(-1.f, 1.f), dy = real(-1.f, 1.f), dz = real(-1.f, 1.f);
+      const float invLength = 1.f / std::sqrt(dx * dx + dy * dy + dz * dz + 1e-6f);
+      (dx *= invLength, dy *= invLength, dz *= invLength);
+
+      // from far enough back along the direction that most pass near the shape, which is around the origin
+      for (int lane = 0; lane < 8; ++lane)
+        (ox[lane] = real(-50.f, 50.f) - 200.f * dx, oy[lane] = real(-50.f, 50.f) - 200.f * dy, oz[lane] = real(-50.f, 50.f) - 200.f * dz);
+
+      const drawing::kernels::RayLanes rays{.ox = ox.data(), .oy = oy.data(), .oz = oz.data(), .dx = dx, .dy = dy, .dz = dz};
+      const drawing::kernels::Kernels &kernels = drawing::kernels::active();
+
+      for (std::array<float, 8> *lanes: {&px, &py, &pz, &nx, &ny, &nz, &distance})
+        lanes->fill(0.f); // not written where the direction alone rules out any hit
+
+      switch (i % 3)
+      {
+      case 0:
+      {
+        const float radius = real(1.f, 40.f);
+        add(kernels.intersectSphere8({.cx = real(-20.f, 20.f), .cy = real(-20.f, 20.f), .cz = real(-20.f, 20.f), .sqradius = radius * radius}, rays, intersections));
+        break;
+      }
+      case 1:
+        add(kernels.intersectQuad8(
+          {
+            .cx = real(-20.f, 20.f), .cy = real(-20.f, 20.f), .cz = real(-20.f, 20.f),
+            .nx = real(-1.f, 1.f), .ny = real(-1.f, 1.f), .nz = real(-1.f, 1.f),
+            .ax = real(-1.f, 1.f), .ay = real(-1.f, 1.f), .az = real(-1.f, 1.f),
+            .bx = real(-1.f, 1.f), .by = real(-1.f, 1.f), .bz = real(-1.f, 1.f),
+            .al2 = real(10.f, 1000.f), .bl2 = real(10.f, 1000.f)},
+          rays, intersections));
+        break;
+      case 2:
+        add(kernels.intersectCone8(
+          {.sqradius = real(0.01f, 1.f), .minz = real(-40.f, 0.f), .maxz = real(0.f, 40.f), .zslope = real(0.f, 1.f)},
+          rays, intersections));
+        break;
+      }
+
+      for (const std::array<float, 8> *lanes: {&px, &py, &pz, &nx, &ny, &nz, &distance})
+        addFloats(*lanes);
+    }
+
+    // noise at random points of either sign, from near 0 to where floats are far apart (beyond the 289 cell period of
+    // its hash, and where the floor of a coordinate is the coordinate)
+    std::array<float, 8> x, y, z, noise;
+
+    for (int i = 0; i < 300; ++i)
+    {
+      const float scale = std::array{1.f, 30.f, 1000.f, 1e5f, 3e7f}[i % 5];
+
+      for (int lane = 0; lane < 8; ++lane)
+        (x[lane] = real(-scale, scale), y[lane] = real(-scale, scale), z[lane] = real(-scale, scale));
+
+      drawing::kernels::active().perlin8(x.data(), y.data(), z.data(), noise.data());
+      addFloats(noise);
+    }
+
+    // gradient lookups (with the gathers where there are any) of t in [0, 1], exactly 0 and 1, halfway between two
+    // entries, beyond either end, infinite and NaN, in tables of random sizes
+    std::array<float, 8> t, r, g, b;
+
+    for (int i = 0; i < 300; ++i)
+    {
+      const int entries = uniform(2, 300);
+      std::vector<float> tableR(entries), tableG(entries), tableB(entries);
+
+      for (int entry = 0; entry < entries; ++entry)
+        (tableR[entry] = real(0.f, 1.f), tableG[entry] = real(0.f, 1.f), tableB[entry] = real(0.f, 1.f));
+
+      for (float &tl: t)
+        switch (uniform(0, 7))
+        {
+        case 0: tl = std::numeric_limits<float>::quiet_NaN(); break;
+        case 1: tl = real(-2.f, 0.f); break;
+        case 2: tl = real(1.f, 2.f); break;
+        case 3: tl = 1.f; break;
+        case 4: tl = 0.f; break;
+        case 5: tl = ((float)uniform(0, entries - 2) + 0.5f) / (float)(entries - 1); break;
+        case 6: tl = uniform(0, 1) ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity(); break;
+        default: tl = real(0.f, 1.f); break;
+        }
+
+      drawing::kernels::active().lookupGradient8(
+        tableR.data(), tableG.data(), tableB.data(), entries, t.data(), r.data(), g.data(), b.data());
+      (addFloats(r), addFloats(g), addFloats(b));
+    }
+
+    return checksum.value;
+  }
+
+  // Whether drawDepthVolume draws the same with blender's SIMD versions as with its scalar callback alone: the active
+  // kernels' for MixArgbConst1, and GCC/Clang vectors for BlendArgbConst1 (which MixArgbConst1 is too, so they draw
+  // what its kernel leaves: the tails of rows after the AVX2 and NEON kernels' blocks of 8, and whole rows with the
+  // scalar and SSE4.1 kernels). Random volumes with random thickness, mostly of widths which aren't a multiple of any
+  // vector width, are drawn at random places (some clipped) and biases over random depth, and every pixel compared.
+  bool
+  drawDepthVolumeAgrees(const auto &blender)
+  {
+    constexpr int w = 101, h = 13;
+    std::minstd_rand random{11};
+    auto uniform = [&](int min, int max) {return std::uniform_int_distribution<int>{min, max}(random);};
+    auto perPixel = [&](uint32_t argb, uint8_t thickness) {return blender(argb, thickness);};
+
+    CpuFrameBuffer simdFrameBuffer{w, h}, scalarFrameBuffer{w, h};
+    bool agree = true;
+
+    simdFrameBuffer.useWith(
+      [&](const ViewOfCpuFrameBuffer &simd)
+      {
+        scalarFrameBuffer.useWith(
+          [&](const ViewOfCpuFrameBuffer &scalar)
+          {
+            for (int y = 0; y < h; ++y)
+              for (int x = 0; x < w; ++x)
+              {
+                simd.image[y * simd.pitch + x] = scalar.image[y * scalar.pitch + x] = (uint32_t)random();
+                simd.depth[y * simd.pitch + x] = scalar.depth[y * scalar.pitch + x] = (int16_t)uniform(-300, 300);
+              }
+
+            for (int i = 0; i < 500; ++i)
+            {
+              const int volumeW = uniform(1, 70), volumeH = uniform(1, 5);
+              const int x = uniform(-volumeW, w), y = uniform(-volumeH, h);
+              const auto bias = (int16_t)uniform(-256, 256);
+
+              CpuDepthVolume volume{volumeW, volumeH};
+
+              for (int j = 0; j < volumeW * volumeH; ++j)
+                volume.getUnsafeView().depthAndThickness[j] = uniform(0, 3) ? (uint16_t)random() : (uint16_t)uniform(0, 255);
+
+              drawing::drawDepthVolume(simd, x, y, volume.getUnsafeView(), bias, blender);
+              drawing::drawDepthVolume(scalar, x, y, volume.getUnsafeView(), bias, perPixel);
+            }
+
+            for (int y = 0; y < h; ++y)
+              agree = agree
+                && std::equal(simd.image + y * simd.pitch, simd.image + y * simd.pitch + w, scalar.image + y * scalar.pitch)
+                && std::equal(simd.depth + y * simd.pitch, simd.depth + y * simd.pitch + w, scalar.depth + y * scalar.pitch);
+          });
+      });
+
+    return agree;
+  }
+
+  // whether drawDepthVolume draws the same with every blender's SIMD versions as without them, for the active kernels
+  // (kernelsAgree checks this for each set of kernels the CPU supports, scalar and sse4.1 included)
+  bool
+  drawDepthVolumeAgrees()
+  {
+    using namespace drawing::blending;
+
+    return drawDepthVolumeAgrees(MixArgbConst1{0xff3080c0})
+      && drawDepthVolumeAgrees(AddArgbConst1{0xff203040})
+      && drawDepthVolumeAgrees(MultiplyArgbConst1{0xffc08040})
+      && drawDepthVolumeAgrees(AlphaOverArgbConst1{0x80a0b0c0});
+  }
+
+  // whether every set of drawing kernels the CPU supports draws the same as the scalar kernels; leaves the active set
+  bool
+  kernelsAgree()
+  {
+    const std::string active = drawing::kernels::active().name;
+    uint64_t scalarChecksum = 0;
+    bool agree = true;
+
+    for (const drawing::kernels::Kernels *kernels: drawing::kernels::supported())
+    {
+      drawing::kernels::use(kernels->name);
+      const uint64_t checksum = drawRandomSprites();
+
+      if (kernels == drawing::kernels::supported().front())
+        scalarChecksum = checksum;
+      else if (checksum != scalarChecksum)
+      {
+        std::cerr << "drawing kernels " << kernels->name << " draw differently from scalar" << std::endl;
+        agree = false;
+      }
+
+      if (!drawDepthVolumeAgrees())
+      {
+        std::cerr << "drawDepthVolume with drawing kernels " << kernels->name << " draws differently with SIMD blending than without" << std::endl;
+        agree = false;
+      }
+    }
+
+    drawing::kernels::use(active);
+    return agree;
+  }
+
+  Options
+  parseOptions(int argc, char *argv[])
+  {
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+      const std::string_view arg{argv[i]};
+
+      if (arg == "--csv")
+        options.csv = true;
+      else if (arg.starts_with("--min-seconds="))
+        options.minSeconds = std::atof(argv[i] + std::string_view{"--min-seconds="}.size());
+      else if (arg.starts_with("--kernels="))
+        options.kernels = arg.substr(std::string_view{"--kernels="}.size());
+      else if (arg.starts_with("--resolutions="))
+      {
+        options.resolutions.clear();
+        std::istringstream list{std::string{arg.substr(std::string_view{"--resolutions="}.size())}};
+
+        for (std::string item; std::getline(list, item, ',');)
+        {
+          glm::ivec2 resolution{};
+          char x{};
+
+          if (!(std::istringstream{item} >> resolution.x >> x >> resolution.y) || x != 'x' || resolution.x <= 0 || resolution.y <= 0)
+            throw std::runtime_error("bad resolution: " + item);
+
+          options.resolutions.push_back(resolution);
+        }
+      }
+      else
+        throw std::runtime_error("unknown argument: " + std::string{arg});
+    }
+
+    return options;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  try
+  {
+    const Options options = parseOptions(argc, argv);
+
+    if (!options.kernels.empty())
+      drawing::kernels::use(options.kernels);
+
+    if (!kernelsAgree())
+      return 1;
+
+    std::cerr << "drawing kernels: " << drawing::kernels::active().name << std::endl;
+
+    CpuImageWithDepth sprite{spriteSize, spriteSize};
+    makeDiscImage(sprite.getUnsafeView());
+    sprite.measureMinDepth();
+    const ViewOfCpuImageWithDepth spriteView = sprite.getUnsafeView();
+
+    CpuDepthVolume volume{spriteSize, spriteSize};
+    makeSphereVolume(volume.getUnsafeView());
+    const ViewOfCpuDepthVolume volumeView = volume.getUnsafeView();
+
+    const auto sphere = raycasting::shapes::makeSphere(glm::vec3{0.8f, 0.5f, 0.2f}, glm::vec3{0.f}, 100.f);
+    const auto sphere8 = raycasting::shapes::makeSphere8(glm::vec3{0.8f, 0.5f, 0.2f}, glm::vec3{0.f}, 100.f);
+    const raycasting::DirectionalLight light{glm::normalize(glm::vec3{1.f, 1.f, -1.f}), glm::vec3{1.f}};
+
+    Report report{options.csv};
+
+    for (const glm::ivec2 resolution: options.resolutions)
+    {
+      const int w = resolution.x, h = resolution.y;
+      const int64_t n = int64_t(w) * h;
+
+      CpuFrameBuffer frameBuffer{w, h};
+      CpuFrameBuffer lazyFrameBuffer{w, h, true};
+
+      CpuInterleavedFrameBuffer<8> interleaved8FrameBuffer{w, h};
+      CpuInterleavedFrameBuffer<16> interleaved16FrameBuffer{w, h};
+      std::vector<uint32_t> resolved(n);
+
+      // only used while the frame buffers exist
+      ViewOfCpuFrameBuffer lazyDest{};
+      ViewOfCpuInterleavedFrameBuffer<8> interleaved8Dest{};
+      ViewOfCpuInterleavedFrameBuffer<16> interleaved16Dest{};
+      lazyFrameBuffer.useWith([&](const ViewOfCpuFrameBuffer &view) {lazyDest = view;});
+      interleaved8FrameBuffer.useWith([&](const ViewOfCpuInterleavedFrameBuffer<8> &view) {interleaved8Dest = view;});
+      interleaved16FrameBuffer.useWith([&](const ViewOfCpuInterleavedFrameBuffer<16> &view) {interleaved16Dest = view;});
+
+      frameBuffer.useWith(
+        [&](const ViewOfCpuFrameBuffer &dest)
+        {
+          // the raw kernels, without culling against the depth pyramid
+          ViewOfCpuFrameBuffer destWithoutHiz = dest;
+          destWithoutHiz.hiz = {};
+
+          auto whole = [&](const std::string &kernel, int64_t bytesPerPixel, auto &&run)
+          {
+            Result result{.kernel = kernel, .w = w, .h = h, .density = 0.f, .clip = "", .sprites = 0, .pixels = n, .bytes = n * bytesPerPixel};
+            result.seconds = measure(options.minSeconds, &result.repetitions, [] {}, run);
+            report.add(result);
+          };
+
+          whole("fillFast argb", 4, [&] {drawing::kernels::active().fillArgb(dest.image, n, 0xff000000u);});
+          whole("fillFast depth", 2, [&] {drawing::kernels::active().fillDepth(dest.depth, n, (int16_t)0x7fff);});
+          whole("clear", 6, [&] {dest.clear(0xff000000, 0x7fff);});
+          whole("copyFrom", 12, [&] {lazyDest.copyFrom(dest);});
+          whole("scroll", 12, [&] {dest.scroll(3, 2, 0, 0xff000000, 0x7fff);});
+          whole("interleaved8 clear", 6, [&] {interleaved8Dest.clear(0xff000000, 0x7fff);});
+          whole("interleaved16 clear", 6, [&] {interleaved16Dest.clear(0xff000000, 0x7fff);});
+          whole("interleaved8 resolve", 8, [&] {interleaved8Dest.resolve(resolved.data(), w);});
+          whole("interleaved16 resolve", 8, [&] {interleaved16Dest.resolve(resolved.data(), w);});
+
+          for (const float density: densities)
+            for (const Clip clip: clips)
+            {
+              const std::vector<Placement> placements = placeSprites(w, h, density, clip);
+              const int64_t pixels = clippedPixels(w, h, placements);
+
+              auto sprites = [&](const std::string &kernel, int64_t bytesPerPixel, const auto &target, auto &&draw)
+              {
+                Result result{
+                  .kernel = kernel, .w = w, .h = h, .density = density, .clip = clipName(clip),
+                  .sprites = (int64_t)placements.size(), .pixels = pixels, .bytes = pixels * bytesPerPixel};
+
+                result.seconds = measure(
+                  options.minSeconds, &result.repetitions,
+                  [&] {target.clear(0xff000000, 0x7fff);},
+                  [&]
+                  {
+                    for (const Placement &p: placements)
+                      draw(p);
+                  });
+
+                report.add(result);
+              };
+
+              // clearing is part of each repetition, as it is of each frame
+              auto frame = [&](const std::string &kernel, int64_t bytesPerScreenPixel, const auto &target, auto &&finish)
+              {
+                Result result{
+                  .kernel = kernel, .w = w, .h = h, .density = density, .clip = clipName(clip),
+                  .sprites = (int64_t)placements.size(), .pixels = pixels, .bytes = n * bytesPerScreenPixel + pixels * 12};
+
+                result.seconds = measure(
+                  options.minSeconds, &result.repetitions,
+                  [] {},
+                  [&]
+                  {
+                    target.clear(0xff000000, 0x7fff);
+
+                    for (const Placement &p: placements)
+                      drawing::drawWithDepth(target, p.x, p.y, spriteView, p.bias);
+
+                    finish();
+                  });
+
+                report.add(result);
+              };
+
+              const drawing::blending::MixArgbConst1 blender{0xffffffff};
+              const drawing::blending::AddArgbConst1 addBlender{0xff203040};
+              auto addPerPixel = [&](uint32_t argb, uint8_t thickness) {return addBlender(argb, thickness);};
+
+              sprites("drawWithoutDepth", 8, dest, [&](const Placement &p) {drawing::drawWithoutDepth(destWithoutHiz, p.x, p.y, spriteView);});
+              sprites("drawWithDepth", 12, dest, [&](const Placement &p) {drawing::drawWithDepth(destWithoutHiz, p.x, p.y, spriteView, p.bias);});
+              sprites("drawWithDepth hiz", 12, dest, [&](const Placement &p) {drawing::drawWithDepth(dest, p.x, p.y, spriteView, p.bias);});
+              sprites("drawDepthVolume", 14, dest, [&](const Placement &p) {drawing::drawDepthVolume(destWithoutHiz, p.x, p.y, volumeView, p.bias, blender);});
+              sprites("drawDepthVolume add", 14, dest, [&](const Placement &p) {drawing::drawDepthVolume(destWithoutHiz, p.x, p.y, volumeView, p.bias, addBlender);});
+              sprites("drawDepthVolume add per pixel", 14, dest, [&](const Placement &p) {drawing::drawDepthVolume(destWithoutHiz, p.x, p.y, volumeView, p.bias, addPerPixel);});
+              sprites(
+                "interleaved8 drawWithDepth", 12, interleaved8Dest,
+                [&](const Placement &p) {drawing::drawWithDepth(interleaved8Dest, p.x, p.y, spriteView, p.bias);});
+              sprites(
+                "interleaved16 drawWithDepth", 12, interleaved16Dest,
+                [&](const Placement &p) {drawing::drawWithDepth(interleaved16Dest, p.x, p.y, spriteView, p.bias);});
+              sprites(
+                "interleaved8 drawDepthVolume", 14, interleaved8Dest,
+                [&](const Placement &p) {drawing::drawDepthVolume(interleaved8Dest, p.x, p.y, volumeView, p.bias, blender);});
+              sprites(
+                "interleaved16 drawDepthVolume", 14, interleaved16Dest,
+                [&](const Placement &p) {drawing::drawDepthVolume(interleaved16Dest, p.x, p.y, volumeView, p.bias, blender);});
+              frame("clear + drawWithDepth", 6, destWithoutHiz, [] {});
+              frame("clear + drawWithDepth hiz", 6, dest, [] {});
+              frame("lazy clear + drawWithDepth hiz", 6, lazyDest, [&] {lazyDest.finishClear();});
+              frame("interleaved8 clear + drawWithDepth", 14, interleaved8Dest, [&] {interleaved8Dest.resolve(resolved.data(), w);});
+              frame("interleaved16 clear + drawWithDepth", 14, interleaved16Dest, [&] {interleaved16Dest.resolve(resolved.data(), w);});
+            }
+        });
+
+      // ray casting a sphere which fills most of an image of this resolution
+      {
+        CpuImageWithDepth image{w, h};
+        const float step = 220.f / (float)std::min(w, h);
+        const raycasting::cameras::Orthogonal camera{.normal = {0.f, 0.f, 1.f}, .xstep = {step, 0.f, 0.f}, .ystep = {0.f, step, 0.f}};
+
+        auto whole = [&](const std::string &kernel, auto &&run)
+        {
+          Result result{.kernel = kernel, .w = w, .h = h, .density = 0.f, .clip = "", .sprites = 0, .pixels = n, .bytes = n * 4};
+          result.seconds = measure(options.minSeconds, &result.repetitions, [] {}, run);
+          report.add(result);
+        };
+
+        whole("Orthogonal::render", [&] {camera.render(image.getUnsafeView(), sphere, glm::vec3{0.2f}, &light, 1);});
+        whole("Orthogonal::render8", [&] {camera.render8(image.getUnsafeView(), sphere8, glm::vec3{0.2f}, &light, 1);});
+      }
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << "drawing-benchmark: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
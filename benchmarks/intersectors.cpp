@@ -0,0 +1,143 @@
+// Per-ray cost of the tile scenes through type-erased (std::function) intersectors versus composed ones.
+// Each scene is rendered several times with Orthogonal::render on the calling thread and the fastest run is reported.
+// Both versions must produce identical images, otherwise the exit code is 1.
+
+// C++ standard library
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// third party
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/color_space.hpp>
+
+// this project
+#include "CpuImageWithDepth.hpp"
+#include "directions.hpp"
+#include "makeGradient.hpp"
+#include "noisyDiffuse.hpp"
+#include "raycasting/cameras/Orthogonal.hpp"
+#include "raycasting/csg/makeUnion.hpp"
+#include "raycasting/shapes/makeCone.hpp"
+#include "raycasting/shapes/makeQuad.hpp"
+#include "raycasting/shapes/makeSphere.hpp"
+#include "raycasting/transform/translate.hpp"
+
+// benchmarks
+#include "renderBenchmark.hpp"
+
+namespace
+{
+  constexpr int tileIntervalWorld = 100; // same as TileRenderer
+  constexpr int imageWidth = 256, imageHeight = 192; // covers a whole tile at the camera angle below
+  constexpr int runs = 20;
+
+  using Result = RenderBenchmarkResult;
+
+  Result
+  benchmark(
+    const raycasting::cameras::Orthogonal &camera,
+    Function<std::optional<raycasting::Intersection>(raycasting::Ray ray)> auto &&intersect,
+    const std::vector<raycasting::DirectionalLight> &directionalLights)
+  {
+    return renderBenchmark(
+      imageWidth, imageHeight, runs,
+      [&](const ViewOfCpuImageWithDepth &view)
+      {
+        camera.render(view, intersect, glm::vec3{0.2f}, &directionalLights[0], (int)directionalLights.size());
+      });
+  }
+}
+
+int main()
+{
+  using namespace directions;
+  using namespace gradient;
+  using namespace noisyDiffuse;
+  using namespace raycasting;
+  using namespace raycasting::csg;
+  using namespace raycasting::shapes;
+  using namespace raycasting::transform;
+
+  // same camera as main.cpp
+  constexpr float angleAboveHorizon = 60.f;
+  constexpr float angleAroundVertical = 45.f;
+
+  glm::mat3 cameraRotation = glm::mat3(glm::rotate(glm::rotate(glm::mat4(1.f), glm::radians(angleAboveHorizon), right), glm::radians(angleAroundVertical), up));
+
+  cameras::Orthogonal camera{
+    .normal = forward * cameraRotation,
+    .xstep = right * cameraRotation,
+    .ystep = up * cameraRotation};
+
+  const std::vector<DirectionalLight> directionalLights{DirectionalLight{glm::normalize(forward + down), glm::vec3{1.f, 1.f, 1.f}}};
+
+  // same objects as TileRenderer
+  const glm::vec3 coneDiffuse = glm::rgbColor(glm::vec3{98.f, 0.8f, 0.76f});
+
+  auto dirtAndGrass =
+    makeNoisyDiffuse(
+      makeGradient(
+        std::vector<std::pair<float, glm::vec3>>
+          {
+            {0.f, glm::rgbColor(glm::vec3{43.f, 1.f, 0.3f})},
+            {0.7f, glm::rgbColor(glm::vec3{43.f, 0.9f, 0.4f})},
+            {0.8f, glm::rgbColor(glm::vec3{106.f, 1.f, 0.48f})}
+          }));
+  auto quadDiffuse = [=](const glm::vec3 &x) {return dirtAndGrass(x * 0.35f);};
+
+  auto noisySphereDiffuse =
+    makeNoisyDiffuse(
+      makeGradient(
+        std::vector<std::pair<float, glm::vec3>>
+          {
+            {0.f, {1.f, 0.2f, 0.f}},
+            {1.f, {0.f, 0.5f, 1.f}}
+          }));
+  auto sphereDiffuse = [=](const glm::vec3 x) {return noisySphereDiffuse(x * 0.1f);};
+
+  const float halfIntervalPlusMargin = tileIntervalWorld * 0.5f + 1.f;
+  const float coneHeight = -tileIntervalWorld * 0.38f, coneRadius = tileIntervalWorld * 0.38f;
+  const glm::vec3 coneOffset{0.f, 0.f, tileIntervalWorld * 0.5};
+  const float sphereRadius = tileIntervalWorld * 0.38f;
+
+  // type-erased
+  const auto erasedCone = translate(makeCone(coneDiffuse, coneHeight, coneRadius), coneOffset);
+  const auto erasedQuad = makeQuad(quadDiffuse, glm::vec3{0.f}, halfIntervalPlusMargin * forward, halfIntervalPlusMargin * right);
+  const auto erasedSphere = makeSphere(sphereDiffuse, glm::vec3{0.f}, sphereRadius);
+  const auto erasedUnion = makeUnion({erasedCone, erasedQuad, erasedSphere});
+
+  // composed
+  const auto composedCone = translated(cone(coneDiffuse, coneHeight, coneRadius), coneOffset);
+  const auto composedQuad = quad(quadDiffuse, glm::vec3{0.f}, halfIntervalPlusMargin * forward, halfIntervalPlusMargin * right);
+  const auto composedSphere = sphere(sphereDiffuse, glm::vec3{0.f}, sphereRadius);
+  const auto composedUnion = unionOf(composedCone, composedQuad, composedSphere);
+
+  bool allMatch = true;
+
+  auto report = [&](const std::string &scene, Result erased, Result composed)
+  {
+    const bool match = erased.checksum == composed.checksum;
+    allMatch = allMatch && match;
+
+    std::cout
+      << std::left << std::setw(8) << scene << std::right << std::fixed << std::setprecision(2)
+      << std::setw(14) << erased.nanosPerRay
+      << std::setw(14) << composed.nanosPerRay
+      << std::setw(10) << erased.nanosPerRay / composed.nanosPerRay << "x"
+      << (match ? "" : "  IMAGES DIFFER") << std::endl;
+  };
+
+  std::cout << imageWidth << "x" << imageHeight << " rays, best of " << runs << " runs" << std::endl;
+  std::cout << std::left << std::setw(8) << "scene" << std::right << std::setw(14) << "erased ns/ray" << std::setw(14) << "composed" << std::setw(11) << "speedup" << std::endl;
+
+  report("cone", benchmark(camera, erasedCone, directionalLights), benchmark(camera, composedCone, directionalLights));
+  report("quad", benchmark(camera, erasedQuad, directionalLights), benchmark(camera, composedQuad, directionalLights));
+  report("sphere", benchmark(camera, erasedSphere, directionalLights), benchmark(camera, composedSphere, directionalLights));
+  report("union", benchmark(camera, erasedUnion, directionalLights), benchmark(camera, composedUnion, directionalLights));
+
+  return allMatch ? 0 : 1;
+}
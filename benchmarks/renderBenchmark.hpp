@@ -0,0 +1,47 @@
+#pragma once
+
+// The timing and checksum of the raycasting benchmarks (intersectors.cpp, unions.cpp), which compare two versions of
+// the same scene.
+
+// C++ standard library
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+// utility
+#include "Fnv1a.hpp"
+#include "Stopwatch.hpp"
+
+// this project
+#include "CpuImageWithDepth.hpp"
+
+struct RenderBenchmarkResult
+{
+  double nanosPerRay;
+  uint64_t checksum;
+};
+
+// Renders an image of w x h pixels runs times on the calling thread with render(view), which renders into the
+// ViewOfCpuImageWithDepth view, and reports the fastest run. The checksum is FNV-1a over the pixels, so that two
+// versions can be compared (and so the work can't be optimized away).
+RenderBenchmarkResult
+renderBenchmark(int w, int h, int runs, auto &&render)
+{
+  CpuImageWithDepth image{w, h};
+  const ViewOfCpuImageWithDepth view = image.getUnsafeView();
+
+  double bestMillis = std::numeric_limits<double>::max();
+
+  for (int run = 0; run < runs; ++run)
+  {
+    Stopwatch stopwatch;
+    stopwatch.start();
+    render(view);
+    stopwatch.stop();
+    bestMillis = std::min(bestMillis, stopwatch.millis());
+  }
+
+  return {
+    .nanosPerRay = bestMillis * 1e6 / (w * h),
+    .checksum = Fnv1a{}.add(view.drgb, (size_t)view.w * view.h * sizeof(*view.drgb)).value};
+}
@@ -0,0 +1,120 @@
+// Per-ray cost of unions of many small shapes, as a detailed prop would be made of, through makeUnion8 (which tests
+// every shape for every ray) versus makeBvhUnion8 (which only tests the shapes a ray's path through its hierarchy
+// reaches). Each scene is rendered several times with Orthogonal::render8 on the calling thread and the fastest run is
+// reported. Both versions must produce identical images, otherwise the exit code is 1.
+
+// C++ standard library
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// third party
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// this project
+#include "CpuImageWithDepth.hpp"
+#include "directions.hpp"
+#include "raycasting/cameras/Orthogonal.hpp"
+#include "raycasting/csg/makeBvhUnion.hpp"
+#include "raycasting/csg/makeUnion.hpp"
+#include "raycasting/shapes/makeCone.hpp"
+#include "raycasting/shapes/makeSphere.hpp"
+#include "raycasting/transform/translate.hpp"
+
+// benchmarks
+#include "renderBenchmark.hpp"
+
+namespace
+{
+  constexpr int imageWidth = 256, imageHeight = 192;
+  constexpr int runs = 5;
+  constexpr float propRadius = 60.f; // the shapes are scattered within a cube of twice this size
+
+  using Result = RenderBenchmarkResult;
+
+  Result
+  benchmark(
+    const raycasting::cameras::Orthogonal &camera,
+    const raycasting::PacketIntersector &intersect,
+    const std::vector<raycasting::DirectionalLight> &directionalLights)
+  {
+    return renderBenchmark(
+      imageWidth, imageHeight, runs,
+      [&](const ViewOfCpuImageWithDepth &view)
+      {
+        camera.render8(view, intersect, glm::vec3{0.2f}, &directionalLights[0], (int)directionalLights.size());
+      });
+  }
+}
+
+int main()
+{
+  using namespace directions;
+  using namespace raycasting;
+  using namespace raycasting::csg;
+  using namespace raycasting::shapes;
+  using namespace raycasting::transform;
+
+  // same camera as main.cpp, zoomed out to fit the prop
+  constexpr float angleAboveHorizon = 60.f;
+  constexpr float angleAroundVertical = 45.f;
+
+  glm::mat3 cameraRotation = glm::mat3(glm::rotate(glm::rotate(glm::mat4(1.f), glm::radians(angleAboveHorizon), right), glm::radians(angleAroundVertical), up));
+
+  cameras::Orthogonal camera{
+    .normal = forward * cameraRotation,
+    .xstep = 0.6f * right * cameraRotation,
+    .ystep = 0.6f * up * cameraRotation};
+
+  const std::vector<DirectionalLight> directionalLights{DirectionalLight{glm::normalize(forward + down), glm::vec3{1.f, 1.f, 1.f}}};
+
+  bool allMatch = true;
+
+  std::cout << imageWidth << "x" << imageHeight << " rays, best of " << runs << " runs" << std::endl;
+  std::cout << std::left << std::setw(8) << "shapes" << std::right << std::setw(14) << "linear ns/ray" << std::setw(14) << "bvh" << std::setw(11) << "speedup" << std::endl;
+
+  for (int numShapes: {4, 16, 64, 256, 1024})
+  {
+    // the same shapes for every run of the program
+    std::mt19937 random{1};
+    std::uniform_real_distribution<float> position{-propRadius, propRadius}, size{1.f, 6.f}, hue{0.f, 1.f};
+
+    std::vector<PacketIntersector> shapes;
+    std::vector<Bounded<PacketIntersector>> boundedShapes;
+
+    for (int i = 0; i < numShapes; ++i)
+    {
+      const glm::vec3 center{position(random), position(random), position(random)};
+      const glm::vec3 diffuse{hue(random), 0.5f, 1.f - hue(random)};
+      const float radius = size(random);
+
+      if (i % 2)
+      {
+        shapes.push_back(makeSphere8(diffuse, center, radius));
+        boundedShapes.push_back({.intersect = shapes.back(), .bounds = sphereBounds(center, radius)});
+      }
+      else
+      {
+        shapes.push_back(translate8(makeCone8(diffuse, -2.f * radius, radius), center));
+        boundedShapes.push_back({.intersect = shapes.back(), .bounds = translate(coneBounds(-2.f * radius, radius), center)});
+      }
+    }
+
+    const Result linear = benchmark(camera, makeUnion8(std::move(shapes)), directionalLights);
+    const Result bvh = benchmark(camera, makeBvhUnion8(std::move(boundedShapes)).intersect, directionalLights);
+
+    const bool match = linear.checksum == bvh.checksum;
+    allMatch = allMatch && match;
+
+    std::cout
+      << std::left << std::setw(8) << numShapes << std::right << std::fixed << std::setprecision(2)
+      << std::setw(14) << linear.nanosPerRay
+      << std::setw(14) << bvh.nanosPerRay
+      << std::setw(10) << linear.nanosPerRay / bvh.nanosPerRay << "x"
+      << (match ? "" : "  IMAGES DIFFER") << std::endl;
+  }
+
+  return allMatch ? 0 : 1;
+}
@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <memory>
 
+#include "Arena.hpp"
+
 struct ViewOfCpuDepthVolume
 {
   // (depthAndThickness & 0xff) : depth in 0-255
@@ -14,8 +16,9 @@ struct ViewOfCpuDepthVolume
 
 struct CpuDepthVolume
 {
-  CpuDepthVolume(int w, int h)
-    : depthvolume{std::make_unique<uint16_t[]>(w * h)}
+  // the pixels come from arena if it isn't nullptr, and then must not outlive its next reset
+  CpuDepthVolume(int w, int h, Arena *arena = nullptr)
+    : depthvolume{makeArenaOrHeapArray<uint16_t>(w * h, arena)}
     , w{w}, h{h} {}
 
   [[nodiscard]]
@@ -23,6 +26,6 @@ struct CpuDepthVolume
   getUnsafeView() const {return {.depthAndThickness = depthvolume.get(), .w = w, .h = h};}
 
 private:
-  const std::unique_ptr<uint16_t[]> depthvolume;
+  const ArenaOrHeapArray<uint16_t> depthvolume;
   const int w, h;
 };
\ No newline at end of file
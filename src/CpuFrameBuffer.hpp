@@ -2,39 +2,270 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <optional>
+#include <type_traits>
 
-#include "fillFast.hpp"
+#include "Arena.hpp"
 #include "function_traits.hpp"
 
+#include "DepthPyramid.hpp"
+#include "LazyClear.hpp"
+#include "drawing/kernels/active.hpp"
+
 struct ViewOfCpuFrameBuffer
 {
   uint32_t *image;
   int16_t *depth;
   int w, h;
+  int pitch; // distance in pixels between the starts of consecutive rows of both image and depth; negative if stored bottom-up
+  ViewOfDepthPyramid hiz{}; // coarse max depth, if maintained for this view
+  ViewOfLazyClear lazy{}; // blocks not yet cleared, if clearing is deferred for this view
 
+  // With lazy clearing of the whole frame buffer this only records the clear values; see finishClear.
   void clear(uint32_t argbClearValue = 0xff000000, int16_t depthClearValue = 0) const
   {
-    fillFast(image, w * h, argbClearValue);
-    fillFast(depth, w * h, depthClearValue);
+    if (lazy && lazy.isWhole(w, h))
+      lazy.startGeneration(argbClearValue, depthClearValue);
+    else
+    {
+      // with lazy clearing of part of the frame buffer, blocks partly outside this view keep the pending clear values
+      finishClear();
+      fillEagerly(argbClearValue, depthClearValue);
+    }
+
+    if (hiz)
+      hiz.reset(w, h, depthClearValue);
+  }
+
+  // With lazy clearing, fills the blocks overlapping the rectangle [minx, maxx) x [miny, maxy) which haven't been
+  // cleared since the last clear; anything which reads or writes pixels must call this first for the pixels it touches
+  // (the drawing functions do). Without lazy clearing this does nothing.
+  void finishClear(int minx, int miny, int maxx, int maxy) const
+  {
+    // ordinary rather than streaming stores, since the blocks are about to be drawn to
+    fillUncleared(minx, miny, maxx, maxy, [](auto *dst, int n, auto value) {std::fill_n(dst, n, value);});
+  }
+
+  // Fills every block of this view which hasn't been cleared since the last clear, e.g. before presenting it.
+  void finishClear() const
+  {
+    const drawing::kernels::Kernels &kernels = drawing::kernels::active();
+
+    fillUncleared(
+      0, 0, w, h,
+      [&](auto *dst, int n, auto value)
+      {
+        if constexpr (std::is_same_v<decltype(value), uint32_t>)
+          kernels.fillArgb(dst, n, value);
+        else
+          kernels.fillDepth(dst, n, value);
+      });
+  }
+
+  // Overwrites this view with src, which must be the same size: color, depth and (if both have one) the depth pyramid,
+  // which otherwise is reset so that nothing is culled against it. A pending lazy clear is cancelled.
+  void copyFrom(const ViewOfCpuFrameBuffer &src) const
+  {
+    // every block is about to be overwritten, so only marked cleared
+    fillUncleared(0, 0, w, h, [](auto *, int, auto) {});
+
+    for (int y = 0; y < h; ++y)
+    {
+      std::copy_n(src.image + y * src.pitch, w, image + y * pitch);
+      std::copy_n(src.depth + y * src.pitch, w, depth + y * pitch);
+    }
+
+    if (hiz && src.hiz)
+      hiz.copyFrom(src.hiz, w, h);
+    else if (hiz)
+      hiz.reset(w, h, INT16_MAX);
+  }
+
+  // Moves the contents by (dx, dy) pixels and adds depthOffset to every depth other than depthClearValue (so depth must
+  // not overflow), e.g. to follow a camera which moved by whole pixels. The strips this uncovers are cleared, to be
+  // drawn again. The depth pyramid is reset so that nothing is culled against it; once the strips are drawn, update it
+  // from depth to make it tight again. A pending lazy clear is finished first.
+  void scroll(int dx, int dy, int16_t depthOffset, uint32_t argbClearValue = 0xff000000, int16_t depthClearValue = 0) const
+  {
+    finishClear();
+
+    // destination columns which have a source column
+    const int minx = std::clamp(dx, 0, w), maxx = std::clamp(w + dx, 0, w);
+
+    // with dy > 0 rows move down, so go upwards to read each row before it is overwritten
+    for (int i = 0; i < h; ++i)
+    {
+      const int y = dy > 0 ? h - 1 - i : i;
+      uint32_t *imageRow = image + y * pitch;
+      int16_t *depthRow = depth + y * pitch;
+
+      if (y - dy < 0 || y - dy >= h || minx >= maxx)
+      {
+        std::fill_n(imageRow, w, argbClearValue);
+        std::fill_n(depthRow, w, depthClearValue);
+        continue;
+      }
+
+      std::memmove(imageRow + minx, image + (y - dy) * pitch + minx - dx, (maxx - minx) * sizeof(uint32_t));
+      std::memmove(depthRow + minx, depth + (y - dy) * pitch + minx - dx, (maxx - minx) * sizeof(int16_t));
+
+      for (int x = minx; x < maxx; ++x)
+        if (depthRow[x] != depthClearValue)
+          depthRow[x] = int16_t(depthRow[x] + depthOffset);
+
+      std::fill_n(imageRow, minx, argbClearValue);
+      std::fill_n(depthRow, minx, depthClearValue);
+      std::fill_n(imageRow + maxx, w - maxx, argbClearValue);
+      std::fill_n(depthRow + maxx, w - maxx, depthClearValue);
+    }
+
+    if (hiz)
+      hiz.reset(w, h, INT16_MAX);
+  }
+
+  // View of a rectangular region of this view; the region must lie within this view.
+  // Lazy clearing carries over to regions made of whole blocks (or reaching the right or bottom edge);
+  // any other region is cleared now. The depth pyramid likewise only carries over to regions made of whole super blocks,
+  // since drawing recomputes each block it touches from the pixels within the view.
+  [[nodiscard]]
+  ViewOfCpuFrameBuffer
+  subView(int x, int y, int subw, int subh) const
+  {
+    constexpr int blockMask = ViewOfLazyClear::blockSize - 1;
+    constexpr int superBlockMask = ViewOfDepthPyramid::superBlockSize - 1;
+
+    ViewOfLazyClear subLazy{};
+
+    if (lazy)
+    {
+      if (((x | y) & blockMask) == 0 && ((subw & blockMask) == 0 || x + subw == w) && ((subh & blockMask) == 0 || y + subh == h))
+        subLazy = lazy.subView(x, y);
+      else
+        finishClear(x, y, x + subw, y + subh);
+    }
+
+    const bool wholeSuperBlocks = ((subw & superBlockMask) == 0 || x + subw == w) && ((subh & superBlockMask) == 0 || y + subh == h);
+
+    return {
+      .image = image + y * pitch + x, .depth = depth + y * pitch + x, .w = subw, .h = subh, .pitch = pitch,
+      .hiz = wholeSuperBlocks ? hiz.subView(x, y) : ViewOfDepthPyramid{}, .lazy = subLazy};
+  }
+
+private:
+  // Fills runs of uncleared blocks one row of pixels at a time, in memory order, with fill(dst, n, value).
+  void fillUncleared(int minx, int miny, int maxx, int maxy, auto &&fill) const
+  {
+    using L = ViewOfLazyClear;
+
+    if (!lazy)
+      return;
+
+    const uint32_t argbClearValue = lazy.state->argbClearValue;
+    const int16_t depthClearValue = lazy.state->depthClearValue;
+    const int minbx = minx >> L::blockShift, maxbx = ((maxx - 1) >> L::blockShift) + 1;
+
+    for (int by = miny >> L::blockShift; by <= (maxy - 1) >> L::blockShift; ++by)
+    {
+      const int bandMaxY = std::min((by + 1) << L::blockShift, h);
+
+      for (int y = by << L::blockShift; y < bandMaxY; ++y)
+        for (int bx = minbx; bx < maxbx;)
+        {
+          if (lazy.isCleared(bx, by))
+          {
+            ++bx;
+            continue;
+          }
+
+          int runEnd = bx + 1;
+          while (runEnd < maxbx && !lazy.isCleared(runEnd, by))
+            ++runEnd;
+
+          const int runMinX = bx << L::blockShift, runMaxX = std::min(runEnd << L::blockShift, w);
+          fill(image + y * pitch + runMinX, runMaxX - runMinX, argbClearValue);
+          fill(depth + y * pitch + runMinX, runMaxX - runMinX, depthClearValue);
+
+          bx = runEnd;
+        }
+
+      for (int bx = minbx; bx < maxbx; ++bx)
+        lazy.markCleared(bx, by);
+    }
+  }
+
+  void fillEagerly(uint32_t argbClearValue, int16_t depthClearValue) const
+  {
+    const drawing::kernels::Kernels &kernels = drawing::kernels::active();
+
+    if (pitch == w)
+    {
+      kernels.fillArgb(image, w * h, argbClearValue);
+      kernels.fillDepth(depth, w * h, depthClearValue);
+    }
+    else
+      for (int y = 0; y < h; ++y)
+      {
+        kernels.fillArgb(image + y * pitch, w, argbClearValue);
+        kernels.fillDepth(depth + y * pitch, w, depthClearValue);
+      }
   }
 };
 
 // note: use std::optional to contain this if you want a replaceable object, then use std::optional.emplace(...)
 struct CpuFrameBuffer
 {
-  CpuFrameBuffer(int w, int h)
-    : image{std::make_unique<uint32_t[]>(w * h)}
-    , depth{std::make_unique<int16_t[]>(w * h)}
-    , w{w}, h{h} {}
+  // With lazyClear, clear() on the whole frame buffer is deferred: call finishClear() on it before using its pixels
+  // other than through the drawing functions.
+  // pitch is the distance in pixels between rows (0 means w); it can be made to match memory the color is drawn to,
+  // see useWith(externalImage, ...).
+  // If arena isn't nullptr then all the buffers come from it, including the image on the first useWith without an
+  // external image (so that must not be at the same time as another thread uses the arena); the frame buffer must then
+  // not outlive the arena's next reset.
+  CpuFrameBuffer(int w, int h, bool lazyClear = false, int pitch = 0, Arena *arena = nullptr)
+    : w{w}, h{h}, pitch{pitch ? pitch : w}
+    , arena{arena}
+    , depth{makeArenaOrHeapArray<int16_t>(this->pitch * h, arena)}
+    , hiz{w, h, arena}
+    , lazy{lazyClear ? std::optional<LazyClear>{std::in_place, w, h, arena} : std::nullopt} {}
 
   void useWith(Function<void(const ViewOfCpuFrameBuffer &)> auto &&f)
   {
-    f({.image = image.get(), .depth = depth.get(), .w = w, .h = h});
+    if (!image)
+      image = makeArenaOrHeapArray<uint32_t>(pitch * h, arena);
+
+    f(view(image.get(), false));
+  }
+
+  // Draws the color to externalImage (like a locked streaming texture) instead of to this frame buffer's own image.
+  // externalImage must have rows this frame buffer's pitch apart. With flipRows, row 0 of the view is the last row of
+  // externalImage, so an image which is presented flipped needs no flip.
+  void useWith(uint32_t *externalImage, bool flipRows, Function<void(const ViewOfCpuFrameBuffer &)> auto &&f)
+  {
+    f(view(externalImage, flipRows));
   }
 
+  [[nodiscard]] int
+  getPitch() const {return pitch;}
+
 private:
-  const std::unique_ptr<uint32_t[]> image;
-  const std::unique_ptr<int16_t[]> depth;
-  const int w, h;
+  const int w, h, pitch;
+  Arena *const arena;
+  ArenaOrHeapArray<uint32_t> image; // allocated by the first useWith without an external image
+  const ArenaOrHeapArray<int16_t> depth;
+  const DepthPyramid hiz;
+  const std::optional<LazyClear> lazy;
+
+  [[nodiscard]]
+  ViewOfCpuFrameBuffer
+  view(uint32_t *imageRows, bool flipRows) const
+  {
+    // depth is stored in the same row order as the color, so the one pitch serves both
+    const int firstRow = flipRows ? (h - 1) * pitch : 0;
+
+    return {
+      .image = imageRows + firstRow, .depth = depth.get() + firstRow, .w = w, .h = h, .pitch = flipRows ? -pitch : pitch,
+      .hiz = hiz.getUnsafeView(), .lazy = lazy ? lazy->getUnsafeView() : ViewOfLazyClear{}};
+  }
 };
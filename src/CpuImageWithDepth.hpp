@@ -1,25 +1,48 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 
+#include "Arena.hpp"
+
 struct ViewOfCpuImageWithDepth
 {
   uint32_t *drgb; // depth instead of alpha: 0-254 == test, 255 == cull (transparent)
   int w, h;
+  int pitch; // distance in pixels between the starts of consecutive rows
+  uint8_t minDepth{0}; // no opaque pixel has a lower depth; 0 is always safe
+
+  // View of a rectangular region of this view, which must lie within it; it keeps this view's minDepth.
+  [[nodiscard]]
+  ViewOfCpuImageWithDepth
+  subView(int x, int y, int subw, int subh) const {return {.drgb = drgb + y * pitch + x, .w = subw, .h = subh, .pitch = pitch, .minDepth = minDepth};}
 };
 
 // note: use std::optional to contain this if you want a replaceable object, then use std::optional.emplace(...)
 struct CpuImageWithDepth
 {
-  CpuImageWithDepth(int w, int h)
-    : drgb{std::make_unique<uint32_t[]>(w * h)}
+  // the pixels come from arena if it isn't nullptr, and then must not outlive its next reset
+  CpuImageWithDepth(int w, int h, Arena *arena = nullptr)
+    : drgb{makeArenaOrHeapArray<uint32_t>(w * h, arena)}
     , w{w}, h{h} {}
   
   ViewOfCpuImageWithDepth
-  getUnsafeView() const {return {.drgb = drgb.get(), .w = w, .h = h};}
+  getUnsafeView() const {return {.drgb = drgb.get(), .w = w, .h = h, .pitch = w, .minDepth = minDepth};}
+
+  // Call after the image has been written, so drawing can skip it where it is entirely behind the destination.
+  void measureMinDepth()
+  {
+    uint32_t minDrgb = 0xffffffff;
+
+    for (int i = 0; i < w * h; ++i)
+      minDrgb = std::min(minDrgb, drgb[i]);
+
+    minDepth = uint8_t(minDrgb >> 24);
+  }
 
 private:
-  const std::unique_ptr<uint32_t[]> drgb;
+  const ArenaOrHeapArray<uint32_t> drgb;
   const int w, h;
+  uint8_t minDepth{0};
 };
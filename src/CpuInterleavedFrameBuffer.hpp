@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "function_traits.hpp"
+
+// Alternative frame buffer layout, chosen at compile time by using these types instead of CpuFrameBuffer:
+// each row is a sequence of blocks of blockSize pixels holding their color and then their depth, so drawing
+// touches one stream of memory instead of separate color and depth streams.
+// The drawing functions in drawing/interleaved.hpp take it as their destination. There is no depth pyramid
+// or lazy clearing, and the color must be copied out with resolve() before it can be presented.
+template<int blockSize>
+struct InterleavedPixelBlock
+{
+  static_assert(blockSize == 8 || blockSize == 16);
+
+  uint32_t argb[blockSize];
+  int16_t depth[blockSize];
+};
+
+template<int blockSize>
+struct ViewOfCpuInterleavedFrameBuffer
+{
+  using Block = InterleavedPixelBlock<blockSize>;
+
+  Block *blocks;
+  int w, h;
+  int pitch; // distance in blocks between the starts of consecutive rows
+
+  [[nodiscard]] Block *
+  row(int y) const {return blocks + y * pitch;}
+
+  void clear(uint32_t argbClearValue = 0xff000000, int16_t depthClearValue = 0) const
+  {
+    Block block;
+    std::fill_n(block.argb, blockSize, argbClearValue);
+    std::fill_n(block.depth, blockSize, depthClearValue);
+
+    for (int y = 0; y < h; ++y)
+      std::fill_n(row(y), pitch, block);
+  }
+
+  // De-interleaves the color into image, which has w x h pixels and rows imagePitch pixels apart (as in CpuFrameBuffer),
+  // e.g. to present it.
+  void resolve(uint32_t *image, int imagePitch) const
+  {
+    for (int y = 0; y < h; ++y)
+    {
+      const Block *src = row(y);
+      uint32_t *dst = image + y * imagePitch;
+      int x = 0;
+
+      for (; x + blockSize <= w; x += blockSize, ++src)
+        std::memcpy(dst + x, src->argb, sizeof(src->argb));
+
+      if (x < w)
+        std::memcpy(dst + x, src->argb, (w - x) * sizeof(uint32_t));
+    }
+  }
+};
+
+// note: use std::optional to contain this if you want a replaceable object, then use std::optional.emplace(...)
+template<int blockSize>
+struct CpuInterleavedFrameBuffer
+{
+  CpuInterleavedFrameBuffer(int w, int h)
+    : pitch{(w + blockSize - 1) / blockSize}
+    , blocks{std::make_unique<InterleavedPixelBlock<blockSize>[]>(pitch * h)}
+    , w{w}, h{h} {}
+
+  void useWith(Function<void(const ViewOfCpuInterleavedFrameBuffer<blockSize> &)> auto &&f)
+  {
+    f({.blocks = blocks.get(), .w = w, .h = h, .pitch = pitch});
+  }
+
+private:
+  const int pitch;
+  const std::unique_ptr<InterleavedPixelBlock<blockSize>[]> blocks;
+  const int w, h;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "CpuImageWithDepth.hpp"
+
+// run of opaque pixels in one row of a sparse image
+struct SparseSpan
+{
+  uint16_t x, length;
+  uint32_t offset; // index of the first pixel of this span in drgb
+};
+
+struct ViewOfCpuSparseImageWithDepth
+{
+  const uint32_t *rowSpans; // spans of row y are spans[rowSpans[y]] up to spans[rowSpans[y + 1]], sorted by x
+  const SparseSpan *spans;
+  const uint32_t *drgb; // only opaque pixels (depth 0-254), each span contiguous
+  int w, h;
+  uint8_t minDepth; // lowest depth of any pixel
+};
+
+// Span-encoded copy of a CpuImageWithDepth which stores only the opaque pixels, so drawing it never
+// loads or tests transparent pixels.
+// note: use std::optional to contain this if you want a replaceable object, then use std::optional.emplace(...)
+struct CpuSparseImageWithDepth
+{
+  explicit CpuSparseImageWithDepth(const ViewOfCpuImageWithDepth &image)
+    : w{image.w}, h{image.h}
+  {
+    rowSpans.reserve(image.h + 1);
+
+    for (int y = 0; y < image.h; ++y)
+    {
+      rowSpans.push_back((uint32_t)spans.size());
+
+      const uint32_t *row = image.drgb + y * image.pitch;
+
+      for (int x = 0; x < image.w;)
+      {
+        if (row[x] >= 0xff000000)
+        {
+          ++x;
+          continue; // transparent
+        }
+
+        SparseSpan span{.x = (uint16_t)x, .length = 0, .offset = (uint32_t)drgb.size()};
+
+        for (; x < image.w && row[x] < 0xff000000; ++x)
+          drgb.push_back(row[x]);
+
+        span.length = uint16_t(x - span.x);
+        spans.push_back(span);
+      }
+    }
+
+    rowSpans.push_back((uint32_t)spans.size());
+
+    for (uint32_t pixel: drgb)
+      minDepth = std::min(minDepth, uint8_t(pixel >> 24));
+  }
+
+  [[nodiscard]]
+  ViewOfCpuSparseImageWithDepth
+  getUnsafeView() const {return {.rowSpans = rowSpans.data(), .spans = spans.data(), .drgb = drgb.data(), .w = w, .h = h, .minDepth = minDepth};}
+
+private:
+  std::vector<uint32_t> rowSpans;
+  std::vector<SparseSpan> spans;
+  std::vector<uint32_t> drgb;
+  const int w, h;
+  uint8_t minDepth{0xff};
+};
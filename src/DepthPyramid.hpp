@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include "Arena.hpp"
+
+// Coarse max depth of a frame buffer, for rejecting sprites (or parts of sprites) without touching full-resolution depth.
+// Level 0 holds the max depth of each 8x8 pixel block, level 1 the max depth of each 64x64 pixel super block.
+// Depth-tested drawing only ever lowers depth, so a stored max stays a valid upper bound while sprites are drawn;
+// anything which raises depth (like clearing) must reset or update the affected blocks.
+struct ViewOfDepthPyramid
+{
+  static constexpr int blockShift = 3;
+  static constexpr int blockSize = 1 << blockShift;
+  static constexpr int superBlockShift = 6;
+  static constexpr int superBlockSize = 1 << superBlockShift;
+  static constexpr int blocksPerSuperBlock = superBlockSize / blockSize;
+
+  int16_t *blockMax; // nullptr if there is no pyramid for this frame buffer view
+  int16_t *superBlockMax;
+  int pitch, superPitch; // in blocks and super blocks
+
+  explicit operator bool() const {return blockMax != nullptr;}
+
+  // Pyramid of a region of the frame buffer starting at pixel (x, y), which must be a multiple of superBlockSize.
+  [[nodiscard]]
+  ViewOfDepthPyramid
+  subView(int x, int y) const
+  {
+    if (!blockMax || (x | y) & (superBlockSize - 1))
+      return {};
+
+    return {
+      .blockMax = blockMax + (y >> blockShift) * pitch + (x >> blockShift),
+      .superBlockMax = superBlockMax + (y >> superBlockShift) * superPitch + (x >> superBlockShift),
+      .pitch = pitch, .superPitch = superPitch};
+  }
+
+  // Sets every block covering a region of w x h pixels (starting at this view's origin) to depth.
+  void reset(int w, int h, int16_t depth) const
+  {
+    for (int by = 0; by < (h + blockSize - 1) >> blockShift; ++by)
+      std::fill_n(blockMax + by * pitch, (w + blockSize - 1) >> blockShift, depth);
+
+    for (int sy = 0; sy < (h + superBlockSize - 1) >> superBlockShift; ++sy)
+      std::fill_n(superBlockMax + sy * superPitch, (w + superBlockSize - 1) >> superBlockShift, depth);
+  }
+
+  // Sets every block covering a region of w x h pixels to the corresponding block of src, e.g. along with copying the
+  // depth it was built from.
+  void copyFrom(const ViewOfDepthPyramid &src, int w, int h) const
+  {
+    for (int by = 0; by < (h + blockSize - 1) >> blockShift; ++by)
+      std::copy_n(src.blockMax + by * src.pitch, (w + blockSize - 1) >> blockShift, blockMax + by * pitch);
+
+    for (int sy = 0; sy < (h + superBlockSize - 1) >> superBlockShift; ++sy)
+      std::copy_n(src.superBlockMax + sy * src.superPitch, (w + superBlockSize - 1) >> superBlockShift, superBlockMax + sy * superPitch);
+  }
+
+  // Recomputes every block covering a region of w x h pixels from full-resolution depth.
+  void update(const int16_t *depth, int depthPitch, int w, int h) const
+  {
+    for (int by = 0; by < (h + blockSize - 1) >> blockShift; ++by)
+      for (int bx = 0; bx < (w + blockSize - 1) >> blockShift; ++bx)
+        updateBlock(bx, by, depth, depthPitch, w, h);
+
+    for (int sy = 0; sy < (h + superBlockSize - 1) >> superBlockShift; ++sy)
+      for (int sx = 0; sx < (w + superBlockSize - 1) >> superBlockShift; ++sx)
+        updateSuperBlock(sx, sy, w, h);
+  }
+
+  // Recomputes block (bx, by) from full-resolution depth; w and h are the size of the region covered by this view.
+  void updateBlock(int bx, int by, const int16_t *depth, int depthPitch, int w, int h) const
+  {
+    const int minx = bx << blockShift, maxx = std::min(minx + blockSize, w);
+    const int miny = by << blockShift, maxy = std::min(miny + blockSize, h);
+
+    int16_t m = INT16_MIN;
+
+    for (int y = miny; y < maxy; ++y)
+      for (int x = minx; x < maxx; ++x)
+        m = std::max(m, depth[y * depthPitch + x]);
+
+    blockMax[by * pitch + bx] = m;
+  }
+
+  // Recomputes super block (sx, sy) from level 0; w and h are the size of the region covered by this view.
+  void updateSuperBlock(int sx, int sy, int w, int h) const
+  {
+    const int minbx = sx * blocksPerSuperBlock, maxbx = std::min(minbx + blocksPerSuperBlock, (w + blockSize - 1) >> blockShift);
+    const int minby = sy * blocksPerSuperBlock, maxby = std::min(minby + blocksPerSuperBlock, (h + blockSize - 1) >> blockShift);
+
+    int16_t m = INT16_MIN;
+
+    for (int by = minby; by < maxby; ++by)
+      for (int bx = minbx; bx < maxbx; ++bx)
+        m = std::max(m, blockMax[by * pitch + bx]);
+
+    superBlockMax[sy * superPitch + sx] = m;
+  }
+};
+
+struct DepthPyramid
+{
+  // the levels come from arena if it isn't nullptr
+  DepthPyramid(int w, int h, Arena *arena = nullptr)
+    : pitch{(w + ViewOfDepthPyramid::blockSize - 1) >> ViewOfDepthPyramid::blockShift}
+    , superPitch{(w + ViewOfDepthPyramid::superBlockSize - 1) >> ViewOfDepthPyramid::superBlockShift}
+    , blockMax{makeArenaOrHeapArray<int16_t>(pitch * ((h + ViewOfDepthPyramid::blockSize - 1) >> ViewOfDepthPyramid::blockShift), arena)}
+    , superBlockMax{makeArenaOrHeapArray<int16_t>(superPitch * ((h + ViewOfDepthPyramid::superBlockSize - 1) >> ViewOfDepthPyramid::superBlockShift), arena)} {}
+
+  [[nodiscard]]
+  ViewOfDepthPyramid
+  getUnsafeView() const {return {.blockMax = blockMax.get(), .superBlockMax = superBlockMax.get(), .pitch = pitch, .superPitch = superPitch};}
+
+private:
+  const int pitch, superPitch;
+  const ArenaOrHeapArray<int16_t> blockMax;
+  const ArenaOrHeapArray<int16_t> superBlockMax;
+};
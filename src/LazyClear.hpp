@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include "Arena.hpp"
+
+#include "DepthPyramid.hpp"
+
+// Record of which blocks of a frame buffer have really been cleared, so that clearing can be deferred:
+// clearing a frame buffer only starts a new generation, and each 8x8 pixel block (the same blocks as level 0 of the
+// depth pyramid) is filled with the clear values when something first draws to it, while it is going to be in cache
+// anyway, or when the frame is finished if nothing draws to it.
+struct LazyClearState
+{
+  uint8_t *blockGeneration; // of the whole frame buffer
+  int w, h; // of the whole frame buffer, in pixels
+  int numBlocks;
+  uint8_t generation; // blocks with a different generation have not been cleared since the last clear
+  uint32_t argbClearValue;
+  int16_t depthClearValue;
+};
+
+struct ViewOfLazyClear
+{
+  static constexpr int blockShift = ViewOfDepthPyramid::blockShift;
+  static constexpr int blockSize = ViewOfDepthPyramid::blockSize;
+
+  uint8_t *blockGeneration; // nullptr if clearing is not deferred for this frame buffer view
+  LazyClearState *state;
+  int pitch; // in blocks
+
+  explicit operator bool() const {return blockGeneration != nullptr;}
+
+  // Blocks of a region of the frame buffer starting at pixel (x, y), which must be a multiple of blockSize.
+  [[nodiscard]]
+  ViewOfLazyClear
+  subView(int x, int y) const
+  {
+    if (!blockGeneration || (x | y) & (blockSize - 1))
+      return {};
+
+    return {.blockGeneration = blockGeneration + (y >> blockShift) * pitch + (x >> blockShift), .state = state, .pitch = pitch};
+  }
+
+  // true if this view of size w x h pixels is the whole frame buffer
+  [[nodiscard]] bool
+  isWhole(int w, int h) const {return blockGeneration == state->blockGeneration && w == state->w && h == state->h;}
+
+  [[nodiscard]] bool
+  isCleared(int bx, int by) const {return blockGeneration[by * pitch + bx] == state->generation;}
+
+  void markCleared(int bx, int by) const {blockGeneration[by * pitch + bx] = state->generation;}
+
+  // Every block of the frame buffer becomes not cleared, to be cleared to these values later.
+  void startGeneration(uint32_t argbClearValue, int16_t depthClearValue) const
+  {
+    // generation 0 is only used after wrapping around, when every block is set to it
+    if (++state->generation == 0)
+    {
+      std::fill_n(state->blockGeneration, state->numBlocks, uint8_t(0));
+      state->generation = 1;
+    }
+
+    state->argbClearValue = argbClearValue;
+    state->depthClearValue = depthClearValue;
+  }
+};
+
+struct LazyClear
+{
+  // the record comes from arena if it isn't nullptr
+  LazyClear(int w, int h, Arena *arena = nullptr)
+    : pitch{(w + ViewOfLazyClear::blockSize - 1) >> ViewOfLazyClear::blockShift}
+    , numBlocks{pitch * ((h + ViewOfLazyClear::blockSize - 1) >> ViewOfLazyClear::blockShift)}
+    , blockGeneration{makeArenaOrHeapArray<uint8_t>(numBlocks, arena)}
+    , state{makeArenaOrHeapArray<LazyClearState>(1, arena)}
+  {
+    // the frame buffer starts zeroed, which is generation 0 cleared to zero
+    *state.get() = {
+      .blockGeneration = blockGeneration.get(), .w = w, .h = h, .numBlocks = numBlocks,
+      .generation = 0, .argbClearValue = 0, .depthClearValue = 0};
+  }
+
+  [[nodiscard]]
+  ViewOfLazyClear
+  getUnsafeView() const {return {.blockGeneration = blockGeneration.get(), .state = state.get(), .pitch = pitch};}
+
+private:
+  const int pitch, numBlocks;
+  const ArenaOrHeapArray<uint8_t> blockGeneration;
+  const ArenaOrHeapArray<LazyClearState> state;
+};
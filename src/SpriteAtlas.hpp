@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "CpuImageWithDepth.hpp"
+
+// An image packed into a SpriteAtlas.
+struct AtlasSprite
+{
+  ViewOfCpuImageWithDepth image; // into the atlas, with the atlas' pitch
+  int x, y; // of the image's top left pixel within the atlas
+  glm::ivec3 anchor;
+};
+
+// Images with depth packed into one allocation by a shelf packer, so that drawing them doesn't jump between separate
+// heap blocks, and memory use is one known size.
+// The atlas and each of its rows start on a cache line, and so does each image (its x is a multiple of alignment pixels);
+// pixels not covered by an image are transparent.
+// An atlas saved as it is (e.g. to a SpriteCache) can be wrapped where it is loaded instead, without copying it.
+// note: use std::optional to contain this if you want a replaceable object, then use std::optional.emplace(...)
+class SpriteAtlas
+{
+public:
+  static constexpr int alignment = 16; // pixels, one 64 byte cache line
+
+  // Copies images (with their anchors) into the atlas; sprite(i) is images[i] there.
+  SpriteAtlas(std::span<const ViewOfCpuImageWithDepth> images, std::span<const glm::ivec3> anchors)
+  {
+    if (images.size() != anchors.size())
+      throw std::runtime_error("SpriteAtlas: need one anchor per image");
+
+    sprites.resize(images.size());
+    pack(images);
+
+    pixels.reset(new (std::align_val_t{cacheLineBytes}) uint32_t[size_t(w) * size_t(h)]);
+    (view = pixels.get(), pitch = w);
+    std::fill_n(pixels.get(), size_t(w) * size_t(h), 0xff000000u);
+
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+      const ViewOfCpuImageWithDepth &src = images[i];
+      AtlasSprite &sprite = sprites[i];
+
+      sprite.image = getUnsafeView().subView(sprite.x, sprite.y, src.w, src.h);
+      sprite.image.minDepth = src.minDepth;
+      sprite.anchor = anchors[i];
+
+      for (int y = 0; y < src.h; ++y)
+        std::copy_n(src.drgb + y * src.pitch, src.w, sprite.image.drgb + y * sprite.image.pitch);
+    }
+  }
+
+  // Wraps the pixels of an atlas owned by something else, which must outlive this, with images (and their anchors) which
+  // are views into it; sprite(i) is images[i].
+  SpriteAtlas(const ViewOfCpuImageWithDepth &atlas, std::span<const ViewOfCpuImageWithDepth> images, std::span<const glm::ivec3> anchors)
+    : view{atlas.drgb}
+    , w{atlas.w}
+    , h{atlas.h}
+    , pitch{atlas.pitch}
+  {
+    if (images.size() != anchors.size())
+      throw std::runtime_error("SpriteAtlas: need one anchor per image");
+
+    sprites.resize(images.size());
+
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+      const ViewOfCpuImageWithDepth &image = images[i];
+      const ptrdiff_t offset = image.drgb - atlas.drgb;
+      AtlasSprite &sprite = sprites[i];
+
+      if (image.pitch != pitch || pitch <= 0 || offset < 0)
+        throw std::runtime_error("SpriteAtlas: image is not within the atlas");
+
+      (sprite.image = image, sprite.anchor = anchors[i]);
+      (sprite.x = int(offset % pitch), sprite.y = int(offset / pitch));
+
+      if (sprite.x + image.w > w || sprite.y + image.h > h)
+        throw std::runtime_error("SpriteAtlas: image is not within the atlas");
+    }
+  }
+
+  [[nodiscard]] const AtlasSprite &
+  sprite(size_t i) const {return sprites[i];}
+
+  // the whole atlas
+  [[nodiscard]]
+  ViewOfCpuImageWithDepth
+  getUnsafeView() const {return {.drgb = view, .w = w, .h = h, .pitch = pitch};}
+
+private:
+  static constexpr size_t cacheLineBytes = alignment * sizeof(uint32_t);
+
+  struct AlignedDelete
+  {
+    void operator()(uint32_t *p) const {::operator delete[](p, std::align_val_t{cacheLineBytes});}
+  };
+
+  std::vector<AtlasSprite> sprites;
+  std::unique_ptr<uint32_t[], AlignedDelete> pixels; // nullptr if wrapped
+  uint32_t *view{nullptr}; // pixels, or the wrapped atlas
+  int w{0}, h{0}, pitch{0};
+
+  static int alignUp(int x) {return (x + alignment - 1) & ~(alignment - 1);}
+
+  // Places the images on shelves, tallest first, filling each shelf from the left before starting the next one below;
+  // the atlas is about as wide as it is tall, but at least as wide as the widest image.
+  void pack(std::span<const ViewOfCpuImageWithDepth> images)
+  {
+    int64_t area = 0;
+    int widest = 0;
+
+    for (const ViewOfCpuImageWithDepth &image: images)
+    {
+      area += int64_t(alignUp(image.w)) * image.h;
+      widest = std::max(widest, alignUp(image.w));
+    }
+
+    w = std::max({alignment, widest, alignUp((int)std::ceil(std::sqrt((double)area)))});
+
+    std::vector<size_t> order(images.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {return images[a].h > images[b].h;});
+
+    int shelfy = 0, shelfh = 0, x = 0;
+
+    for (size_t i: order)
+    {
+      if (x + images[i].w > w)
+        (shelfy += shelfh, shelfh = 0, x = 0);
+
+      (sprites[i].x = x, sprites[i].y = shelfy);
+      shelfh = std::max(shelfh, images[i].h);
+      x += alignUp(images[i].w);
+    }
+
+    h = std::max(1, shelfy + shelfh);
+  }
+};
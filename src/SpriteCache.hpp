@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <MappedFile.hpp>
+
+#include "CpuDepthVolume.hpp"
+#include "CpuImageWithDepth.hpp"
+
+// File of baked sprites (images with depth and depth volumes, each with an anchor) which is memory-mapped when loaded,
+// so sprites are drawn straight from the page cache without being copied or recomputed.
+// The file stores a 64-bit key (meant to be a hash of everything that went into baking); a file with a different key
+// is treated as missing. Byte order and layout are native: the cache is a local build artifact, not an interchange format.
+//
+// An image entry may be a rectangle of another's pixels instead of having its own (see SpriteCacheWriter::addSubImage),
+// e.g. a sprite within an atlas, so that the atlas is mapped and drawn from as it is.
+//
+// layout:
+//   SpriteCacheHeader
+//   SpriteCacheEntry[numEntries]
+//   the pixels of each entry which has its own at its offset, which is a multiple of spriteCacheAlignment
+
+constexpr char spriteCacheMagic[8] = {'2', 'd', 's', 'p', 'r', 'i', 't', 'e'};
+constexpr uint32_t spriteCacheVersion = 2;
+constexpr uint64_t spriteCacheAlignment = 64;
+
+struct SpriteCacheHeader
+{
+  char magic[8]; // spriteCacheMagic
+  uint32_t version;
+  uint32_t numEntries;
+  uint64_t key;
+  uint64_t fileSize;
+};
+
+struct SpriteCacheEntry
+{
+  enum Kind : uint32_t {imageWithDepth = 1, depthVolume = 2};
+
+  char name[24]; // null-terminated
+  Kind kind;
+  int32_t w, h;
+  int32_t anchorx, anchory, anchorz;
+  uint8_t minDepth; // only for imageWithDepth
+  uint8_t reserved[3]; // zero
+  int32_t pitch; // pixels between the starts of consecutive rows; w for a depthVolume
+  uint64_t offset; // of the first pixel, from the start of the file
+};
+
+static_assert(sizeof(SpriteCacheHeader) == 32);
+static_assert(sizeof(SpriteCacheEntry) == 64);
+
+// Collects views of sprites, then writes them all to a cache file. The views must stay valid until write() returns.
+class SpriteCacheWriter
+{
+public:
+  void add(std::string_view name, const ViewOfCpuImageWithDepth &image, glm::ivec3 anchor = {})
+  {
+    add(name, SpriteCacheEntry::imageWithDepth, image.w, image.h, anchor, image.minDepth, image.drgb, image.pitch, sizeof(image.drgb[0]));
+  }
+
+  void add(std::string_view name, const ViewOfCpuDepthVolume &volume, glm::ivec3 anchor = {})
+  {
+    add(name, SpriteCacheEntry::depthVolume, volume.w, volume.h, anchor, 0, volume.depthAndThickness, volume.w, sizeof(volume.depthAndThickness[0]));
+  }
+
+  // An image which is the rectangle of image's size at x, y of the image already added as within, sharing its pixels;
+  // only image's w, h and minDepth are used.
+  void addSubImage(std::string_view name, std::string_view within, int x, int y, const ViewOfCpuImageWithDepth &image, glm::ivec3 anchor = {})
+  {
+    add(name, SpriteCacheEntry::imageWithDepth, image.w, image.h, anchor, image.minDepth, nullptr, 0, sizeof(image.drgb[0]));
+    (sprites.back().within = within, sprites.back().x = x, sprites.back().y = y);
+  }
+
+  // Writes to a temporary file next to path which then replaces path, so a reader never sees a partial file.
+  // throws std::runtime_error on failure
+  void write(const std::filesystem::path &path, uint64_t key) const
+  {
+    const uint64_t tableEnd = sizeof(SpriteCacheHeader) + sprites.size() * sizeof(SpriteCacheEntry);
+
+    std::vector<SpriteCacheEntry> entries;
+    entries.reserve(sprites.size());
+
+    uint64_t offset = tableEnd;
+
+    for (const Sprite &sprite: sprites)
+    {
+      entries.push_back(sprite.entry);
+
+      if (sprite.data)
+      {
+        offset = alignUp(offset);
+        entries.back().offset = offset;
+        offset += sprite.numBytes;
+      }
+    }
+
+    for (size_t i = 0; i < sprites.size(); ++i)
+      if (!sprites[i].data)
+      {
+        const SpriteCacheEntry &image = findWithin(sprites[i], entries);
+        entries[i].offset = image.offset + (uint64_t(sprites[i].y) * uint64_t(image.pitch) + uint64_t(sprites[i].x)) * sizeof(uint32_t);
+        entries[i].pitch = image.pitch;
+      }
+
+    SpriteCacheHeader header{.version = spriteCacheVersion, .numEntries = (uint32_t)entries.size(), .key = key, .fileSize = offset};
+    std::memcpy(header.magic, spriteCacheMagic, sizeof(header.magic));
+
+    if (path.has_parent_path())
+      std::filesystem::create_directories(path.parent_path());
+
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+
+    {
+      std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+
+      if (!file)
+        throw std::runtime_error("SpriteCacheWriter: could not create " + tempPath.string());
+
+      file.write((const char *)&header, sizeof(header));
+      file.write((const char *)entries.data(), std::streamsize(entries.size() * sizeof(SpriteCacheEntry)));
+
+      uint64_t position = tableEnd;
+
+      for (size_t i = 0; i < sprites.size(); ++i)
+      {
+        if (!sprites[i].data)
+          continue; // pixels are another's
+
+        static constexpr char zeros[spriteCacheAlignment]{};
+        file.write(zeros, std::streamsize(entries[i].offset - position));
+
+        // rows are stored without padding, whatever their pitch in memory
+        for (int y = 0; y < sprites[i].entry.h; ++y)
+          file.write((const char *)sprites[i].data + y * sprites[i].pitchBytes, std::streamsize(sprites[i].rowBytes));
+
+        position = entries[i].offset + sprites[i].numBytes;
+      }
+
+      if (!file.flush())
+        throw std::runtime_error("SpriteCacheWriter: could not write " + tempPath.string());
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+
+    if (error)
+    {
+      std::filesystem::remove(tempPath, error);
+      throw std::runtime_error("SpriteCacheWriter: could not replace " + path.string());
+    }
+  }
+
+private:
+  struct Sprite
+  {
+    SpriteCacheEntry entry;
+    const void *data; // nullptr for a sub-image
+    uint64_t rowBytes, pitchBytes;
+    uint64_t numBytes;
+    std::string within; // for a sub-image: the name of the image it is within, and where
+    int x{0}, y{0};
+  };
+
+  std::vector<Sprite> sprites;
+
+  static uint64_t alignUp(uint64_t x) {return (x + spriteCacheAlignment - 1) & ~(spriteCacheAlignment - 1);}
+
+  // the entry of the image with its own pixels which sub-image sprite is within
+  // throws std::runtime_error if there is none, or the sub-image isn't within it
+  const SpriteCacheEntry &findWithin(const Sprite &sprite, const std::vector<SpriteCacheEntry> &entries) const
+  {
+    for (size_t i = 0; i < sprites.size(); ++i)
+    {
+      const SpriteCacheEntry &image = entries[i];
+
+      if (sprites[i].data && image.kind == SpriteCacheEntry::imageWithDepth && sprite.within == image.name)
+      {
+        if (sprite.x < 0 || sprite.y < 0 || sprite.x + sprite.entry.w > image.w || sprite.y + sprite.entry.h > image.h)
+          throw std::runtime_error("SpriteCacheWriter: " + std::string(sprite.entry.name) + " is not within " + sprite.within);
+
+        return image;
+      }
+    }
+
+    throw std::runtime_error("SpriteCacheWriter: no image " + sprite.within + " for " + std::string(sprite.entry.name) + " to be within");
+  }
+
+  void add(std::string_view name, SpriteCacheEntry::Kind kind, int w, int h, glm::ivec3 anchor, uint8_t minDepth, const void *data, int pitch, size_t pixelSize)
+  {
+    if (name.size() >= sizeof(SpriteCacheEntry::name))
+      throw std::runtime_error("SpriteCacheWriter: name too long: " + std::string(name));
+
+    SpriteCacheEntry entry{
+      .kind = kind, .w = w, .h = h,
+      .anchorx = anchor.x, .anchory = anchor.y, .anchorz = anchor.z,
+      .minDepth = minDepth, .pitch = w};
+    name.copy(entry.name, name.size());
+
+    sprites.push_back(Sprite{
+      .entry = entry, .data = data,
+      .rowBytes = uint64_t(w) * pixelSize, .pitchBytes = uint64_t(pitch) * pixelSize, .numBytes = uint64_t(w) * uint64_t(h) * pixelSize});
+  }
+};
+
+// A loaded cache file. Views returned by image() and volume() point into the mapping, so they are only valid
+// while this object exists; they may be written to (the mapping is copy-on-write) but the file never changes.
+class SpriteCache
+{
+public:
+  // nullopt if there is no readable cache at path, or it has a different key or version, or it is malformed
+  [[nodiscard]]
+  static
+  std::optional<SpriteCache>
+  load(const std::filesystem::path &path, uint64_t key)
+  {
+    std::unique_ptr<MappedFile> file;
+
+    try
+    {
+      file = std::make_unique<MappedFile>(path);
+    }
+    catch (const std::runtime_error &)
+    {
+      return std::nullopt;
+    }
+
+    if (file->size() < sizeof(SpriteCacheHeader))
+      return std::nullopt;
+
+    const auto *header = (const SpriteCacheHeader *)file->data();
+
+    if (std::memcmp(header->magic, spriteCacheMagic, sizeof(header->magic)) != 0
+      || header->version != spriteCacheVersion
+      || header->key != key
+      || header->fileSize != file->size()
+      || header->numEntries > (file->size() - sizeof(SpriteCacheHeader)) / sizeof(SpriteCacheEntry))
+      return std::nullopt;
+
+    const auto *entries = (const SpriteCacheEntry *)(file->data() + sizeof(SpriteCacheHeader));
+
+    for (uint32_t i = 0; i < header->numEntries; ++i)
+    {
+      const SpriteCacheEntry &entry = entries[i];
+      const uint64_t pixelSize = entry.kind == SpriteCacheEntry::imageWithDepth ? sizeof(uint32_t) : sizeof(uint16_t);
+
+      // from the first pixel to the end of the last row
+      const uint64_t extent = entry.h > 0 ? (uint64_t(entry.h - 1) * uint64_t(entry.pitch) + uint64_t(entry.w)) * pixelSize : 0;
+
+      if ((entry.kind != SpriteCacheEntry::imageWithDepth && entry.kind != SpriteCacheEntry::depthVolume)
+        || entry.w < 0 || entry.h < 0
+        || entry.pitch < entry.w || (entry.kind == SpriteCacheEntry::depthVolume && entry.pitch != entry.w)
+        || entry.offset % pixelSize != 0
+        || entry.offset > file->size()
+        || extent > file->size() - entry.offset
+        || std::memchr(entry.name, 0, sizeof(entry.name)) == nullptr)
+        return std::nullopt;
+    }
+
+    return SpriteCache{std::move(file)};
+  }
+
+  // nullopt if there is no image with this name; if anchor is not nullptr then it receives the stored anchor
+  [[nodiscard]]
+  std::optional<ViewOfCpuImageWithDepth>
+  image(std::string_view name, glm::ivec3 *anchor = nullptr) const
+  {
+    const SpriteCacheEntry *entry = find(name, SpriteCacheEntry::imageWithDepth, anchor);
+
+    if (!entry)
+      return std::nullopt;
+
+    return ViewOfCpuImageWithDepth{.drgb = (uint32_t *)(file->data() + entry->offset), .w = entry->w, .h = entry->h, .pitch = entry->pitch, .minDepth = entry->minDepth};
+  }
+
+  // nullopt if there is no volume with this name; if anchor is not nullptr then it receives the stored anchor
+  [[nodiscard]]
+  std::optional<ViewOfCpuDepthVolume>
+  volume(std::string_view name, glm::ivec3 *anchor = nullptr) const
+  {
+    const SpriteCacheEntry *entry = find(name, SpriteCacheEntry::depthVolume, anchor);
+
+    if (!entry)
+      return std::nullopt;
+
+    return ViewOfCpuDepthVolume{.depthAndThickness = (uint16_t *)(file->data() + entry->offset), .w = entry->w, .h = entry->h};
+  }
+
+private:
+  std::unique_ptr<MappedFile> file;
+
+  explicit SpriteCache(std::unique_ptr<MappedFile> file) : file{std::move(file)} {}
+
+  const SpriteCacheEntry *
+  find(std::string_view name, SpriteCacheEntry::Kind kind, glm::ivec3 *anchor) const
+  {
+    const auto *header = (const SpriteCacheHeader *)file->data();
+    const auto *entries = (const SpriteCacheEntry *)(file->data() + sizeof(SpriteCacheHeader));
+
+    for (uint32_t i = 0; i < header->numEntries; ++i)
+      if (entries[i].kind == kind && name == entries[i].name)
+      {
+        if (anchor)
+          *anchor = {entries[i].anchorx, entries[i].anchory, entries[i].anchorz};
+
+        return &entries[i];
+      }
+
+    return nullptr;
+  }
+};
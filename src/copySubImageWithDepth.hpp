@@ -21,8 +21,8 @@ copySubImageWithDepth(
   for (int y = 0; y < srch; ++y)
     for (int x = 0; x < srcw; ++x)
     {
-      int sindex = (y + srcy) * src.w + x + srcx;
-      int dindex = (y + desty) * dest.w + x + destx;
+      int sindex = (y + srcy) * src.pitch + x + srcx;
+      int dindex = (y + desty) * dest.pitch + x + destx;
 
       dest.drgb[dindex] = src.drgb[sindex];
     }
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <Profiler.hpp>
+#include <WorkerPool.hpp>
+
+#include "DrawStats.hpp"
+#include "drawSparseWithDepth.hpp"
+#include "drawWithDepth.hpp"
+#include "occlusion.hpp"
+#include "../CpuFrameBuffer.hpp"
+#include "../CpuImageWithDepth.hpp"
+#include "../CpuSparseImageWithDepth.hpp"
+
+namespace drawing
+{
+  // Deferred drawWithDepth / drawSparseWithDepth calls which are drawn by splitting the destination into fixed square screen bins.
+  // Each sprite is binned by its clipped rectangle, then each bin draws its sprites in submission order,
+  // clipped to its own region of the destination.
+  // Bins never share pixels so they can be drawn in parallel without write conflicts,
+  // and the result is byte-identical to calling drawWithDepth directly in the same order, with or without a pool.
+  // Optionally the sprites are sorted front-to-back first, so that with the destination's depth pyramid
+  // sprites hidden behind nearer ones are culled before they are drawn (see sortFrontToBack): the result is then that of
+  // drawing the sorted list, which differs from drawing in submission order where sprites have exactly equal depth.
+  class BinnedDrawList
+  {
+  public:
+    static constexpr int binSize = 128;
+
+    void clear() {sprites.clear();}
+
+    // same parameters as drawWithDepth, without the destination
+    void add(int destx, int desty, ViewOfCpuImageWithDepth src, int16_t srcdepthbias)
+    {
+      sprites.push_back(Sprite{
+        .src = src, .destx = destx, .desty = desty, .w = src.w, .h = src.h,
+        .minDepth = src.minDepth + srcdepthbias, .srcdepthbias = srcdepthbias});
+    }
+
+    // same parameters as drawSparseWithDepth, without the destination
+    void add(int destx, int desty, ViewOfCpuSparseImageWithDepth src, int16_t srcdepthbias)
+    {
+      sprites.push_back(Sprite{
+        .src = src, .destx = destx, .desty = desty, .w = src.w, .h = src.h,
+        .minDepth = src.minDepth + srcdepthbias, .srcdepthbias = srcdepthbias});
+    }
+
+    // Stable sort of everything added since the last clear() by nearest depth (depth bias + min depth of the image), so
+    // sprites with the same nearest depth stay in submission order.
+    // Where pixels of different sprites have exactly equal depth the first one drawn wins, so those ties resolve in
+    // sorted order rather than submission order, and the frame isn't byte-identical to drawing the sprites unsorted
+    // (e.g. to drawing them with drawWithDepth in grid order). Drawing serially or in parallel gives the same frame only
+    // for the same sorted list.
+    void sortFrontToBack()
+    {
+      PROFILE_ZONE("sort sprites");
+
+      // LSD radix sort, 8 bits per pass, on the depth clamped to 16 bits and offset so it sorts as unsigned
+      auto key = [](const Sprite &sprite) {return uint16_t(std::clamp(sprite.minDepth, INT16_MIN, INT16_MAX) + 0x8000);};
+
+      sortTemp.resize(sprites.size());
+
+      for (int shift = 0; shift < 16; shift += 8)
+      {
+        std::array<uint32_t, 256> offsets{};
+
+        for (const Sprite &sprite: sprites)
+          ++offsets[(key(sprite) >> shift) & 0xff];
+
+        for (uint32_t i = 0, sum = 0; i < 256; ++i)
+          sum += std::exchange(offsets[i], sum);
+
+        for (const Sprite &sprite: sprites)
+          sortTemp[offsets[(key(sprite) >> shift) & 0xff]++] = sprite;
+
+        std::swap(sprites, sortTemp);
+      }
+    }
+
+    // statistics from the last draw(), summed over all bins
+    [[nodiscard]] const DrawStats &
+    stats() const {return lastStats;}
+
+    // Draws everything added since the last clear().
+    // If pool is nullptr then all bins are drawn on the calling thread.
+    // If background is not nullptr then each bin of dest is first overwritten with the same region of background (which
+    // must be the same size as dest), so dest needn't be cleared and the background is copied while it is drawn over.
+    void draw(const ViewOfCpuFrameBuffer &dest, WorkerPool *pool, const ViewOfCpuFrameBuffer *background = nullptr)
+    {
+      binsx = (dest.w + binSize - 1) / binSize;
+      binsy = (dest.h + binSize - 1) / binSize;
+
+      // keep the inner vectors (and their capacity) between frames
+      if (bins.size() < size_t(binsx * binsy))
+      {
+        bins.resize(binsx * binsy);
+        binStats.resize(binsx * binsy);
+      }
+
+      for (std::vector<uint32_t> &bin: bins)
+        bin.clear();
+
+      for (uint32_t i = 0; i < (uint32_t)sprites.size(); ++i)
+      {
+        const Sprite &sprite = sprites[i];
+
+        const int minx = std::max(sprite.destx, 0);
+        const int miny = std::max(sprite.desty, 0);
+        const int maxx = std::min(sprite.destx + sprite.w, dest.w);
+        const int maxy = std::min(sprite.desty + sprite.h, dest.h);
+
+        if (minx >= maxx || miny >= maxy)
+          continue;
+
+        for (int by = miny / binSize; by <= (maxy - 1) / binSize; ++by)
+          for (int bx = minx / binSize; bx <= (maxx - 1) / binSize; ++bx)
+            bins[by * binsx + bx].push_back(i);
+      }
+
+      auto drawBin = [&](size_t bin)
+      {
+        PROFILE_ZONE("draw bin");
+
+        const int x = int(bin % binsx) * binSize;
+        const int y = int(bin / binsx) * binSize;
+        const ViewOfCpuFrameBuffer region = dest.subView(x, y, std::min(binSize, dest.w - x), std::min(binSize, dest.h - y));
+        DrawStats &stats = binStats[bin] = {};
+
+        if (background)
+          region.copyFrom(background->subView(x, y, region.w, region.h));
+
+        for (uint32_t i: bins[bin])
+        {
+          const Sprite &sprite = sprites[i];
+          const int destx = sprite.destx - x, desty = sprite.desty - y;
+
+          // cull without touching full-resolution depth if entirely behind what has been drawn in this bin
+          if (isOccluded(
+            region,
+            std::max(destx, 0), std::max(desty, 0), std::min(destx + sprite.w, region.w), std::min(desty + sprite.h, region.h),
+            sprite.minDepth))
+          {
+            ++stats.spritesCulled;
+            continue;
+          }
+
+          if (const auto *src = std::get_if<ViewOfCpuImageWithDepth>(&sprite.src))
+            drawWithDepth(region, destx, desty, *src, sprite.srcdepthbias, &stats);
+          else
+            drawSparseWithDepth(region, destx, desty, std::get<ViewOfCpuSparseImageWithDepth>(sprite.src), sprite.srcdepthbias, &stats);
+        }
+      };
+
+      const size_t numBins = binsx * binsy;
+
+      if (pool)
+        pool->forEach(numBins, drawBin);
+      else
+        for (size_t bin = 0; bin < numBins; ++bin)
+          drawBin(bin);
+
+      lastStats = {.spritesSubmitted = sprites.size()};
+
+      for (size_t bin = 0; bin < numBins; ++bin)
+        lastStats += binStats[bin];
+    }
+
+  private:
+    struct Sprite
+    {
+      std::variant<ViewOfCpuImageWithDepth, ViewOfCpuSparseImageWithDepth> src;
+      int destx, desty, w, h;
+      int minDepth; // nearest depth of any pixel, including bias
+      int16_t srcdepthbias;
+    };
+
+    std::vector<Sprite> sprites, sortTemp;
+    std::vector<std::vector<uint32_t>> bins; // indices into sprites, in submission order
+    std::vector<DrawStats> binStats;
+    DrawStats lastStats{};
+    int binsx{}, binsy{};
+  };
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+namespace drawing
+{
+  // Counters for measuring overdraw and the effect of culling.
+  struct DrawStats
+  {
+    uint64_t spritesSubmitted{};
+    uint64_t spritesCulled{}; // entirely occluded before drawing; counted per bin with BinnedDrawList
+    uint64_t pixelsTested{}; // source pixels which reached the per-pixel loops (including transparent pixels of non-sparse images)
+    uint64_t pixelsWritten{}; // source pixels which passed the depth test
+
+    DrawStats &operator+=(const DrawStats &other)
+    {
+      spritesSubmitted += other.spritesSubmitted;
+      spritesCulled += other.spritesCulled;
+      pixelsTested += other.pixelsTested;
+      pixelsWritten += other.pixelsWritten;
+      return *this;
+    }
+  };
+}
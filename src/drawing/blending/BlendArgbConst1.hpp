@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "BlendOps.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#include "gcc_vec_types.hpp"
+#endif
+
+namespace drawing::blending
+{
+  // Blends the constant color argb1 into a destination pixel by t with Op (see BlendOps.hpp), a byte at a time, e.g. as
+  // the callback of drawDepthVolume, which blends by thickness. The vector version of blend is generic over Op and the
+  // number of pixels, so drawDepthVolume blends 4 pixels at a time (with SSE2 or NEON, see native_vector_bytes) with any
+  // Op.
+  template<class Op>
+  struct BlendArgbConst1
+  {
+    const uint32_t argb1;
+
+    explicit BlendArgbConst1(uint32_t argb1)
+      : argb1{argb1} {}
+
+    uint32_t blend(uint32_t argb0, uint8_t t) const
+    {
+      uint32_t argb = 0;
+
+      for (int shift = 0; shift < 32; shift += 8)
+        argb |= Op::blend((argb0 >> shift) & 0xff, (argb1 >> shift) & 0xff, argb1 >> 24, (uint32_t)t) << shift;
+
+      return argb;
+    }
+
+    // so this can be passed directly as a blending callback, e.g. to drawDepthVolume
+    uint32_t operator()(uint32_t argb0, uint8_t t) const {return blend(argb0, t);}
+
+#if defined(__GNUC__) || defined(__clang__)
+    // any number of pixels at once, with the same results as the scalar version: V is a vector of uint32_t, t in 0-255
+    template<GccVector V>
+    V blend(V argb0, V t) const
+    {
+      // Op blends half of the bytes at a time, widened to 16 bits for its intermediate results: vectors wider than V
+      // could be wider than the vector registers, and then GCC does some of Op's arithmetic a lane at a time.
+      using half = gcc_vector<uint8_t, sizeof(V) / 2>;
+      using words = gcc_vector<uint16_t, sizeof(V) / 2>;
+
+      const V zero{};
+      const V argb1s = zero + argb1, alpha1s = zero + (argb1 >> 24) * 0x01010101u, ts = t * 0x01010101u;
+
+      auto widen = [](const V &v, size_t h)
+      {
+        half bytes;
+        std::memcpy(&bytes, (const char *)&v + h * sizeof(half), sizeof(half));
+        return __builtin_convertvector(bytes, words);
+      };
+
+      V argb;
+
+      for (size_t h = 0; h < 2; ++h)
+      {
+        const half bytes = __builtin_convertvector(Op::blend(widen(argb0, h), widen(argb1s, h), widen(alpha1s, h), widen(ts, h)), half);
+        std::memcpy((char *)&argb + h * sizeof(half), &bytes, sizeof(half));
+      }
+
+      return argb;
+    }
+#endif
+  };
+
+  // drawDepthVolume draws with this through the drawing kernels (see MixArgb.hpp), rather than with its vector blend
+  using MixArgbConst1 = BlendArgbConst1<Mix>;
+  using AddArgbConst1 = BlendArgbConst1<Add>;
+  using MultiplyArgbConst1 = BlendArgbConst1<Multiply>;
+  using AlphaOverArgbConst1 = BlendArgbConst1<AlphaOver>;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <type_traits>
+
+namespace drawing::blending
+{
+  // Blend operators, for BlendArgbConst1: each blends a source byte into a destination byte by t, where srcAlpha is the
+  // alpha byte of the source pixel, all in 0-255. T is an unsigned integer, or a GCC/Clang vector of 16 bit unsigned
+  // integers which blends many bytes at once, so blend is written once with the arithmetic both have, and its
+  // intermediate results must fit in 16 bits (as 255 * 255 does). Another operator is another such struct, and then
+  // blends as many pixels at a time as the vector version does.
+
+  namespace detail
+  {
+    // min(x, 255) for either kind of T
+    template<class T>
+    T min255(T x)
+    {
+      if constexpr (std::is_integral_v<T>)
+        return x < 255 ? x : 255;
+      else
+        return x ^ ((x ^ 255) & (T)(x > 255)); // comparing vectors gives all bits set where true
+    }
+  }
+
+  // interpolates from dst to src, as MixByte
+  struct Mix
+  {
+    template<class T>
+    static T blend(T dst, T src, T /*srcAlpha*/, T t) {return (dst * (255 - t) + src * t) / 255;}
+  };
+
+  // adds src times t, saturating
+  struct Add
+  {
+    template<class T>
+    static T blend(T dst, T src, T /*srcAlpha*/, T t) {return detail::min255(dst + src * t / 255);}
+  };
+
+  // multiplies by src, interpolated from 255 (no change) by t
+  struct Multiply
+  {
+    template<class T>
+    static T blend(T dst, T src, T /*srcAlpha*/, T t) {return dst * Mix::blend(T{} + 255, src, T{}, t) / 255;}
+  };
+
+  // src over dst by src's alpha, times t
+  struct AlphaOver
+  {
+    template<class T>
+    static T blend(T dst, T src, T srcAlpha, T t) {return Mix::blend(dst, src, T{}, srcAlpha * t / 255);}
+  };
+}
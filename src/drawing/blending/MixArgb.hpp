@@ -1,9 +1,12 @@
 #pragma once
 
+#include "BlendArgbConst1.hpp"
 #include "MixByte.hpp"
 
 namespace drawing::blending
 {
+  // Interpolates between pixels by t, as MixByte each of their bytes. The intrinsics versions are those of the drawing
+  // kernels' drawDepthVolumeRowMixArgbConst1 row, and give the same results as MixArgbConst1 (BlendArgbConst1<Mix>).
   struct MixArgb
   {
     static
@@ -12,19 +15,41 @@ namespace drawing::blending
       uint32_t t32 = (t << 24) | (t << 16) | (t << 8) | t;
       return MixByte::mix(argb0, argb1, t32);
     }
-  };
 
-  struct MixArgbConst1
-  {
-    const uint32_t argb1;
+#ifdef __AVX2__
+    // 8 pixels at once: t is in the low byte of each 32 bit lane
+    static
+    __m256i mix8(__m256i argb0, __m256i argb1, __m256i t)
+    {
+      const __m256i broadcastLowByte = _mm256_setr_epi8(
+        0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12,
+        0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
 
-    explicit MixArgbConst1(uint32_t argb1)
-      : argb1{argb1} {}
+      return MixByte::mix(argb0, argb1, _mm256_shuffle_epi8(t, broadcastLowByte));
+    }
+#endif
 
-    uint32_t mix(uint32_t argb0, uint8_t t) const
+#ifdef __AVX512BW__
+    // 16 pixels at once, as mix8
+    static
+    __m512i mix16(__m512i argb0, __m512i argb1, __m512i t)
     {
-      uint32_t t32 = (t << 24) | (t << 16) | (t << 8) | t;
-      return MixByte::mix(argb0, argb1, t32);
+      const __m512i broadcastLowByte = _mm512_set4_epi32(0x0c0c0c0c, 0x08080808, 0x04040404, 0x00000000);
+
+      return MixByte::mix(argb0, argb1, _mm512_shuffle_epi8(t, broadcastLowByte));
+    }
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+    // 4 pixels at once: t is in the low byte of each 32 bit lane, the other bytes 0
+    static
+    uint32x4_t mix4(uint32x4_t argb0, uint32x4_t argb1, uint32x4_t t)
+    {
+      const uint32x4_t t32 = vmulq_n_u32(t, 0x01010101); // as in mix
+
+      return vreinterpretq_u32_u8(MixByte::mix(
+        vreinterpretq_u8_u32(argb0), vreinterpretq_u8_u32(argb1), vreinterpretq_u8_u32(t32)));
     }
+#endif
   };
 }
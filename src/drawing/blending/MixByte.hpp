@@ -2,7 +2,15 @@
 
 #include <cstdint>
 
-#if defined(__GCC__) || defined(__clang__)
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
 #include "gcc_vec_types.hpp"
 
 #endif
@@ -28,7 +36,73 @@ namespace drawing::blending
       return r.s;
     }
 
-#if defined(__GCC__) || defined(__clang__)
+#ifdef __AVX2__
+    // 32 bytes at once, with the same results as the scalar version
+    static
+    __m256i
+    mix(__m256i a, __m256i b, __m256i t)
+    {
+      const __m256i zero = _mm256_setzero_si256();
+      const __m256i u16_255 = _mm256_set1_epi16(255);
+      const __m256i u16_0x8081 = _mm256_set1_epi16((short)0x8081);
+
+      auto mix16 = [&](__m256i a16, __m256i b16, __m256i t16)
+      {
+        // x / 255 == (x * 0x8081) >> 23 for all 16 bit x
+        __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(a16, _mm256_sub_epi16(u16_255, t16)), _mm256_mullo_epi16(b16, t16));
+        return _mm256_srli_epi16(_mm256_mulhi_epu16(sum, u16_0x8081), 7);
+      };
+
+      __m256i lo = mix16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero), _mm256_unpacklo_epi8(t, zero));
+      __m256i hi = mix16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero), _mm256_unpackhi_epi8(t, zero));
+
+      return _mm256_packus_epi16(lo, hi);
+    }
+#endif
+
+#ifdef __AVX512BW__
+    // 64 bytes at once, the same as the AVX2 version in each 256 bit half
+    static
+    __m512i
+    mix(__m512i a, __m512i b, __m512i t)
+    {
+      const __m512i zero = _mm512_setzero_si512();
+      const __m512i u16_255 = _mm512_set1_epi16(255);
+      const __m512i u16_0x8081 = _mm512_set1_epi16((short)0x8081);
+
+      auto mix16 = [&](__m512i a16, __m512i b16, __m512i t16)
+      {
+        __m512i sum = _mm512_add_epi16(_mm512_mullo_epi16(a16, _mm512_sub_epi16(u16_255, t16)), _mm512_mullo_epi16(b16, t16));
+        return _mm512_srli_epi16(_mm512_mulhi_epu16(sum, u16_0x8081), 7);
+      };
+
+      __m512i lo = mix16(_mm512_unpacklo_epi8(a, zero), _mm512_unpacklo_epi8(b, zero), _mm512_unpacklo_epi8(t, zero));
+      __m512i hi = mix16(_mm512_unpackhi_epi8(a, zero), _mm512_unpackhi_epi8(b, zero), _mm512_unpackhi_epi8(t, zero));
+
+      return _mm512_packus_epi16(lo, hi);
+    }
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+    // 16 bytes at once, with the same results as the scalar version
+    static
+    uint8x16_t
+    mix(uint8x16_t a, uint8x16_t b, uint8x16_t t)
+    {
+      const uint8x16_t tInv = vmvnq_u8(t); // 255 - t
+      const uint16x8_t u16_1 = vdupq_n_u16(1);
+
+      uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(a), vget_low_u8(tInv)), vget_low_u8(b), vget_low_u8(t));
+      uint16x8_t hi = vmlal_high_u8(vmull_high_u8(a, tInv), b, t);
+
+      // x / 255 == (x + (x >> 8) + 1) >> 8 for x up to 255 * 255
+      auto div255 = [&](uint16x8_t x) {return vshrn_n_u16(vaddq_u16(vaddq_u16(x, vshrq_n_u16(x, 8)), u16_1), 8);};
+
+      return vcombine_u8(div255(lo), div255(hi));
+    }
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
     template<GccVector V>
     static
     V mix(V a, V b, V t)
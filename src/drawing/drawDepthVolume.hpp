@@ -1,131 +1,160 @@
 #pragma once
 
+#include <concepts>
+#include <cstring>
+#include <type_traits>
+
 #include <glm/common.hpp>
 #include <glm/vec3.hpp>
 
 #include <function_traits.hpp>
+#if defined(__GNUC__) || defined(__clang__)
+#include <gcc_vec_types.hpp>
+#endif
 
 #include "clip.hpp"
+#include "blending/MixArgb.hpp"
+#include "kernels/active.hpp"
 #include "../CpuFrameBuffer.hpp"
 #include "../CpuDepthVolume.hpp"
 
 namespace drawing
 {
-  //static void
-  //drawDepthVolume(
-  //  ViewOfCpuFrameBuffer dest, int destx, int desty,
-  //  ViewOfCpuDepthVolume src, int16_t srcdepthbias,
-  //  Function<uint32_t(uint32_t destArgb, uint8_t thickness)> auto &&argbFromThickness)
-  //{
-  //  const int minsy = clipMin(desty, dest.h, src.h);
-  //  const int maxsy = clipMax(desty, dest.h, src.h);
-  //  const int minsx = clipMin(destx, dest.w, src.w);
-  //  const int maxsx = clipMax(destx, dest.w, src.w);
-  //
-  //  constexpr size_t blockSize = 8;
-  //  const size_t width = maxsx - minsx;
-  //  const size_t blockWidth = width - width % blockSize;
-  //
-  //  for (int y = minsy; y < maxsy; ++y)
-  //  {
-  //    uint16_t *__restrict psrc = src.depthAndThickness + y * src.w + minsx;
-  //    int16_t *__restrict pdestdepth = dest.depth + (desty + y) * dest.w + destx + minsx;
-  //    uint32_t *__restrict pdestargb = dest.image + (desty + y) * dest.w + destx + minsx;
-  //
-  //    for (size_t i = 0; i < blockWidth; i += blockSize)
-  //    {
-  //      // TODO: block of blockSize values
-  //    }
-  //
-  //    for (size_t i = blockWidth; i < width; ++i)
-  //    {
-  //      // TODO: single value
-  //      struct
-  //
-  //
-  //    }
-  //
-  //    for (int x = minsx; x < maxsx; ++x)
-  //    {
-  //      //uint16_t srcDepthAndThickness = src.depthAndThickness[y * src.w + x];
-  //      uint16_t srcDepthAndThickness = psrc[x];
-  //      uint8_t thickness = srcDepthAndThickness >> 8;
-  //
-  //      if (thickness == 0)
-  //        continue;
-  //
-  //      //int dindex = (desty + y) * dest.w + (destx + x);
-  //      //int dindex = dindexrow + x;
-  //      //int destDepth = dest.depth[dindex];
-  //      int destDepth = pdestdepth[x];
-  //
-  //      int srcDepthBiased = (srcDepthAndThickness & 0xff) + srcdepthbias;
-  //
-  //      if (int destMinusSrcDepth = destDepth - srcDepthBiased; destMinusSrcDepth > 0)
-  //      {
-  //        //uint32_t destArgb = dest.image[dindex];
-  //        uint32_t destArgb = pdestargb[x];
-  //        uint8_t clippedThickness = glm::min(destMinusSrcDepth, (int)thickness);
-  //        pdestargb[x] = argbFromThickness(destArgb, clippedThickness);
-  //        pdestdepth[x] = srcDepthBiased;
-  //        //dest.image[dindex] = argbFromThickness(destArgb, clippedThickness);
-  //        //dest.depth[dindex] = srcDepthBiased;
-  //      }
-  //    }
-  //  }
-  //}
+#if defined(__GNUC__) || defined(__clang__)
+  // Optional extension of the argbFromThickness callback of drawDepthVolume, without intrinsics: if the callback also
+  // has blend for vectors of uint32_t (as blending::BlendArgbConst1 has), with the thickness in each lane, then
+  // drawDepthVolume blends 4 pixels at a time. This path is SSE2/NEON only (see native_vector_bytes): it isn't compiled
+  // for each instruction set as the drawing kernels are. blend must give the same results as the scalar callback.
+  template<class F>
+  concept ThicknessBlenderVector = requires(const F &f, gcc_vector<uint32_t, native_vector_bytes / sizeof(uint32_t)> v)
+  {
+    {f.blend(v, v)} -> std::same_as<decltype(v)>;
+  };
+#endif
 
-  static
-  void
-  drawDepthVolume(
-    ViewOfCpuFrameBuffer dest, int destx, int desty,
-    ViewOfCpuDepthVolume src, int16_t srcdepthbias,
-    Function<uint32_t(uint32_t destArgb, uint8_t thickness)> auto &&argbFromThickness)
+  namespace detail
   {
-    const int minsy = clipMin(desty, dest.h, src.h);
-    const int maxsy = clipMax(desty, dest.h, src.h);
-    const int minsx = clipMin(destx, dest.w, src.w);
-    const int maxsx = clipMax(destx, dest.w, src.w);
+#if defined(__GNUC__) || defined(__clang__)
+    // Draws as many whole blocks of 4 pixels of one row as possible, as drawDepthVolumeRow8 does 8 with AVX2; returns
+    // the number of pixels drawn.
+    static
+    int
+    drawDepthVolumeRowVector(
+      const uint16_t *__restrict psrc, int16_t *__restrict pdestdepth, uint32_t *__restrict pdestargb, int width,
+      int16_t srcdepthbias,
+      const ThicknessBlenderVector auto &blender)
+    {
+      constexpr int simdSize = native_vector_bytes / sizeof(uint32_t);
+      using u32v = gcc_vector<uint32_t, simdSize>;
+      using i32v = gcc_vector<int32_t, simdSize>;
+      using u16v = gcc_vector<uint16_t, simdSize>;
+      using i16v = gcc_vector<int16_t, simdSize>;
 
-    constexpr size_t blockSize = 8;
-    const size_t width = maxsx - minsx;
-    const size_t blockWidth = width - width % blockSize;
+      const int vecWidth = width - width % simdSize;
 
-    for (int y = minsy; y < maxsy; ++y)
+      for (int i = 0; i < vecWidth; i += simdSize)
+      {
+        u16v src_depth_and_thickness_16;
+        std::memcpy(&src_depth_and_thickness_16, psrc + i, sizeof(u16v));
+        i32v src_depth_and_thickness = __builtin_convertvector(src_depth_and_thickness_16, i32v);
+        i32v thickness = src_depth_and_thickness >> 8;
+
+        if (!any_lane(thickness))
+          continue; // all transparent
+
+        i16v dst_depth_16;
+        std::memcpy(&dst_depth_16, pdestdepth + i, sizeof(i16v));
+        i32v dst_depth = __builtin_convertvector(dst_depth_16, i32v);
+        i32v src_depth_biased = (src_depth_and_thickness & 0xff) + srcdepthbias;
+        i32v dst_minus_src_depth = dst_depth - src_depth_biased;
+
+        i32v mask = (thickness != 0) & (dst_minus_src_depth > 0); // all bits set where drawn
+
+        if (!any_lane(mask))
+          continue; // all src_depth >= dst_depth
+
+        u32v dst_argb;
+        std::memcpy(&dst_argb, pdestargb + i, sizeof(u32v));
+        i32v clipped_thickness = thickness ^ ((thickness ^ dst_minus_src_depth) & (dst_minus_src_depth < thickness));
+        u32v blended_argb = blender.blend(dst_argb, (u32v)(clipped_thickness & mask));
+
+        // where the mask is set src_depth_biased < dst_depth so it fits in 16 bits
+        i16v new_depth_16 = __builtin_convertvector((src_depth_biased & mask) | (dst_depth & ~mask), i16v);
+        u32v new_argb = (blended_argb & (u32v)mask) | (dst_argb & ~(u32v)mask);
+
+        std::memcpy(pdestdepth + i, &new_depth_16, sizeof(i16v));
+        std::memcpy(pdestargb + i, &new_argb, sizeof(u32v));
+      }
+
+      return vecWidth;
+    }
+#endif
+
+    // Draws width pixels of one row.
+    static
+    void
+    drawDepthVolumeRow(
+      const uint16_t *__restrict psrc, int16_t *__restrict pdestdepth, uint32_t *__restrict pdestargb, int width,
+      int16_t srcdepthbias,
+      Function<uint32_t(uint32_t destArgb, uint8_t thickness)> auto &&argbFromThickness)
     {
-      uint16_t *__restrict psrc = src.depthAndThickness + y * src.w;
-      int16_t *__restrict pdestdepth = dest.depth + (desty + y) * dest.w + destx;
-      uint32_t *__restrict pdestargb = dest.image + (desty + y) * dest.w + destx;
-      //int dindexrow = (desty + y) * dest.w + destx;
+      int x = 0;
 
+      // The usual blender has a kernel for whatever instruction set the CPU has, which draws none of the row with the
+      // scalar and SSE4.1 kernels. Then it, like other blenders, uses SSE2 or NEON vectors for what is left.
+      if constexpr (std::is_same_v<std::remove_cvref_t<decltype(argbFromThickness)>, blending::MixArgbConst1>)
+        x += kernels::active().drawDepthVolumeRowMixArgbConst1(psrc, pdestdepth, pdestargb, width, srcdepthbias, argbFromThickness.argb1);
+#if defined(__GNUC__) || defined(__clang__)
+      if constexpr (ThicknessBlenderVector<std::remove_cvref_t<decltype(argbFromThickness)>>)
+        x += drawDepthVolumeRowVector(psrc + x, pdestdepth + x, pdestargb + x, width - x, srcdepthbias, argbFromThickness);
+#endif
 
-      for (int x = minsx; x < maxsx; ++x)
+      // scalar version, also handles the tail of the SIMD version
+      for (; x < width; ++x)
       {
-        //uint16_t srcDepthAndThickness = src.depthAndThickness[y * src.w + x];
         uint16_t srcDepthAndThickness = psrc[x];
         uint8_t thickness = srcDepthAndThickness >> 8;
 
         if (thickness == 0)
           continue;
 
-        //int dindex = (desty + y) * dest.w + (destx + x);
-        //int dindex = dindexrow + x;
-        //int destDepth = dest.depth[dindex];
         int destDepth = pdestdepth[x];
 
         int srcDepthBiased = (srcDepthAndThickness & 0xff) + srcdepthbias;
 
         if (int destMinusSrcDepth = destDepth - srcDepthBiased; destMinusSrcDepth > 0)
         {
-          //uint32_t destArgb = dest.image[dindex];
           uint32_t destArgb = pdestargb[x];
           uint8_t clippedThickness = glm::min(destMinusSrcDepth, (int)thickness);
           pdestargb[x] = argbFromThickness(destArgb, clippedThickness);
           pdestdepth[x] = srcDepthBiased;
-          //dest.image[dindex] = argbFromThickness(destArgb, clippedThickness);
-          //dest.depth[dindex] = srcDepthBiased;
         }
       }
     }
   }
+
+  static
+  void
+  drawDepthVolume(
+    ViewOfCpuFrameBuffer dest, int destx, int desty,
+    ViewOfCpuDepthVolume src, int16_t srcdepthbias,
+    Function<uint32_t(uint32_t destArgb, uint8_t thickness)> auto &&argbFromThickness)
+  {
+    const int minsy = clipMin(desty, dest.h, src.h);
+    const int maxsy = clipMax(desty, dest.h, src.h);
+    const int minsx = clipMin(destx, dest.w, src.w);
+    const int maxsx = clipMax(destx, dest.w, src.w);
+
+    if (minsx >= maxsx || minsy >= maxsy)
+      return;
+
+    dest.finishClear(destx + minsx, desty + minsy, destx + maxsx, desty + maxsy);
+
+    for (int y = minsy; y < maxsy; ++y)
+      detail::drawDepthVolumeRow(
+        src.depthAndThickness + y * src.w + minsx,
+        dest.depth + (desty + y) * dest.pitch + destx + minsx,
+        dest.image + (desty + y) * dest.pitch + destx + minsx,
+        maxsx - minsx, srcdepthbias, argbFromThickness);
+  }
 }
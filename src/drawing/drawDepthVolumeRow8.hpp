@@ -0,0 +1,65 @@
+#pragma once
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "blending/MixArgb.hpp"
+
+// For the AVX2 drawing kernels, which include it without the rest of drawDepthVolume.hpp (see kernels/define.hpp):
+// nothing else is compiled with AVX2 (see CMakeLists.txt).
+namespace drawing
+{
+#ifdef __AVX2__
+  namespace detail
+  {
+    // Draws as many whole blocks of 8 pixels of one row as possible with blending::MixArgbConst1{argb1}, blending with
+    // blending::MixArgb::mix8; returns the number of pixels drawn.
+    inline // (not static: the AVX-512 kernels include it without using it)
+    int
+    drawDepthVolumeRow8(
+      const uint16_t *__restrict psrc, int16_t *__restrict pdestdepth, uint32_t *__restrict pdestargb, int width,
+      int16_t srcdepthbias, uint32_t argb1)
+    {
+      constexpr int simdSize = 8;
+      const int vecWidth = width - width % simdSize;
+
+      const __m256i zero = _mm256_setzero_si256();
+      const __m256i u32_0x000000ff = _mm256_set1_epi32(0xff);
+      const __m256i src_depth_bias = _mm256_set1_epi32(srcdepthbias);
+      const __m256i argb1s = _mm256_set1_epi32((int)argb1);
+
+      for (int i = 0; i < vecWidth; i += simdSize)
+      {
+        __m256i src_depth_and_thickness = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)(psrc + i)));
+        __m256i thickness = _mm256_srli_epi32(src_depth_and_thickness, 8);
+
+        if (_mm256_testz_si256(thickness, thickness))
+          continue; // all transparent
+
+        __m256i dst_depth = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *)(pdestdepth + i)));
+        __m256i src_depth_biased = _mm256_add_epi32(_mm256_and_si256(src_depth_and_thickness, u32_0x000000ff), src_depth_bias);
+        __m256i dst_minus_src_depth = _mm256_sub_epi32(dst_depth, src_depth_biased);
+
+        __m256i mask = _mm256_andnot_si256(_mm256_cmpeq_epi32(thickness, zero), _mm256_cmpgt_epi32(dst_minus_src_depth, zero));
+
+        if (_mm256_testz_si256(mask, mask))
+          continue; // all src_depth >= dst_depth
+
+        __m256i dst_argb = _mm256_loadu_si256((__m256i *)(pdestargb + i));
+        __m256i clipped_thickness = _mm256_min_epi32(dst_minus_src_depth, thickness);
+        __m256i blended_argb = blending::MixArgb::mix8(dst_argb, argb1s, clipped_thickness);
+
+        // where the mask is set src_depth_biased < dst_depth so it fits in 16 bits without saturating
+        __m256i new_depth_32 = _mm256_blendv_epi8(dst_depth, src_depth_biased, mask);
+        __m128i new_depth_16 = _mm_packs_epi32(_mm256_castsi256_si128(new_depth_32), _mm256_extracti128_si256(new_depth_32, 1));
+
+        _mm_storeu_si128((__m128i *)(pdestdepth + i), new_depth_16);
+        _mm256_storeu_si256((__m256i *)(pdestargb + i), _mm256_blendv_epi8(dst_argb, blended_argb, mask));
+      }
+
+      return vecWidth;
+    }
+  }
+#endif
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+
+#include "clip.hpp"
+#include "DrawStats.hpp"
+#include "occlusion.hpp"
+#include "kernels/active.hpp"
+#include "../CpuFrameBuffer.hpp"
+#include "../CpuSparseImageWithDepth.hpp"
+
+namespace drawing
+{
+  // Same result as drawWithDepth with the CpuImageWithDepth the sparse image was made from,
+  // but transparent pixels are skipped a whole span at a time instead of being loaded and tested.
+  // stats may be nullptr
+  static void
+  drawSparseWithDepth(
+    ViewOfCpuFrameBuffer dest, int destx, int desty,
+    ViewOfCpuSparseImageWithDepth src, int16_t srcdepthbias,
+    DrawStats *stats = nullptr)
+  {
+    const int minsy = clipMin(desty, dest.h, src.h);
+    const int maxsy = clipMax(desty, dest.h, src.h);
+    const int minsx = clipMin(destx, dest.w, src.w);
+    const int maxsx = clipMax(destx, dest.w, src.w);
+
+    if (minsx >= maxsx || minsy >= maxsy)
+      return;
+
+    detail::drawUnoccluded(
+      dest, destx + minsx, desty + minsy, destx + maxsx, desty + maxsy, src.minDepth + srcdepthbias,
+      [&](int minx, int miny, int maxx, int maxy)
+      {
+        // source coordinates
+        const int rectminsx = minx - destx, rectmaxsx = maxx - destx;
+
+        uint32_t *pdestimage = dest.image + miny * dest.pitch + destx;
+        int16_t *pdestdepth = dest.depth + miny * dest.pitch + destx;
+        const auto drawOpaqueSpanWithDepth = kernels::active().drawOpaqueSpanWithDepth;
+        int tested = 0, written = 0;
+
+        for (int sy = miny - desty; sy < maxy - desty; ++sy, pdestimage += dest.pitch, pdestdepth += dest.pitch)
+          for (uint32_t ispan = src.rowSpans[sy]; ispan < src.rowSpans[sy + 1]; ++ispan)
+          {
+            const SparseSpan span = src.spans[ispan];
+
+            if (span.x >= rectmaxsx)
+              break; // spans are sorted by x
+
+            const int spanminsx = std::max((int)span.x, rectminsx);
+            const int spanmaxsx = std::min(span.x + span.length, rectmaxsx);
+
+            if (spanminsx < spanmaxsx)
+            {
+              written += drawOpaqueSpanWithDepth(
+                src.drgb + span.offset + (spanminsx - span.x), pdestimage + spanminsx, pdestdepth + spanminsx,
+                spanmaxsx - spanminsx, srcdepthbias);
+              tested += spanmaxsx - spanminsx;
+            }
+          }
+
+        if (stats)
+        {
+          stats->pixelsTested += tested;
+          stats->pixelsWritten += written;
+        }
+      });
+  }
+}
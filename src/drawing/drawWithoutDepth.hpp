@@ -1,6 +1,7 @@
 #pragma once
 
 #include "clip.hpp"
+#include "kernels/active.hpp"
 #include "../CpuFrameBuffer.hpp"
 #include "../CpuImageWithDepth.hpp"
 
@@ -16,23 +17,15 @@ namespace drawing
     const int minsx = clipMin(destx, dest.w, src.w);
     const int maxsx = clipMax(destx, dest.w, src.w);
 
-    // for each non-clipped pixel in source...
-    for (int sy = minsy; sy < maxsy; ++sy)
-    {
-      int drowstart = (desty + sy) * dest.w + destx;
-      int srowstart = sy * src.w;
+    if (minsx >= maxsx || minsy >= maxsy)
+      return;
+
+    dest.finishClear(destx + minsx, desty + minsy, destx + maxsx, desty + maxsy);
 
-      for (int sx = minsx; sx < maxsx; ++sx)
-      {
-        uint32_t sdrgb = src.drgb[srowstart + sx];
+    const auto drawRowWithoutDepth = kernels::active().drawRowWithoutDepth;
 
-        // source is transparent if source depth == 255, else test against dest
-        if (sdrgb < 0xff000000)
-        {
-          uint32_t sargb = 0xff000000 | (sdrgb & 0xffffff);
-          dest.image[drowstart + sx] = sargb;
-        }
-      }
-    }
+    // each non-clipped row of source, less its transparent pixels
+    for (int sy = minsy; sy < maxsy; ++sy)
+      drawRowWithoutDepth(src.drgb + sy * src.pitch + minsx, dest.image + (desty + sy) * dest.pitch + destx + minsx, maxsx - minsx);
   }
 }
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+
+#include <function_traits.hpp>
+
+#include "clip.hpp"
+#include "drawDepthVolume.hpp"
+#include "drawWithDepth.hpp"
+#include "DrawStats.hpp"
+#include "kernels/active.hpp"
+#include "../CpuDepthVolume.hpp"
+#include "../CpuImageWithDepth.hpp"
+#include "../CpuInterleavedFrameBuffer.hpp"
+
+// drawWithDepth and drawDepthVolume for a CpuInterleavedFrameBuffer destination, with the same results as for a
+// CpuFrameBuffer. Each row is drawn as the spans of it which fall within each block, with the same row kernels
+// as the planar layout; a whole block is one SIMD step for blocks of 8 pixels, or two for blocks of 16.
+
+namespace drawing
+{
+  namespace detail
+  {
+    // Calls drawSpan(block, lane, x, n) for the pixels [minx, maxx) of a row: n pixels starting at the pixel x,
+    // which is lane number lane of block number block.
+    template<int blockSize>
+    static void
+    forEachBlockSpan(int minx, int maxx, Function<void(int block, int lane, int x, int n)> auto &&drawSpan)
+    {
+      for (int x = minx; x < maxx;)
+      {
+        const int block = x / blockSize, lane = x % blockSize;
+        const int n = std::min(blockSize - lane, maxx - x);
+        drawSpan(block, lane, x, n);
+        x += n;
+      }
+    }
+  }
+
+  // stats may be nullptr
+  template<int blockSize>
+  static void
+  drawWithDepth(
+    ViewOfCpuInterleavedFrameBuffer<blockSize> dest, int destx, int desty,
+    ViewOfCpuImageWithDepth src, int16_t srcdepthbias,
+    DrawStats *stats = nullptr)
+  {
+    const int minsy = clipMin(desty, dest.h, src.h);
+    const int maxsy = clipMax(desty, dest.h, src.h);
+    const int minsx = clipMin(destx, dest.w, src.w);
+    const int maxsx = clipMax(destx, dest.w, src.w);
+
+    if (minsx >= maxsx || minsy >= maxsy)
+      return;
+
+    const auto drawRowWithDepth = kernels::active().drawRowWithDepth;
+    int written = 0;
+
+    for (int sy = minsy; sy < maxsy; ++sy)
+    {
+      const uint32_t *psrc = src.drgb + sy * src.pitch;
+      InterleavedPixelBlock<blockSize> *row = dest.row(desty + sy);
+
+      detail::forEachBlockSpan<blockSize>(
+        destx + minsx, destx + maxsx,
+        [&](int block, int lane, int x, int n)
+        {
+          written += drawRowWithDepth(psrc + (x - destx), row[block].argb + lane, row[block].depth + lane, n, srcdepthbias);
+        });
+    }
+
+    if (stats)
+    {
+      stats->pixelsTested += (maxsx - minsx) * (maxsy - minsy);
+      stats->pixelsWritten += written;
+    }
+  }
+
+  template<int blockSize>
+  static
+  void
+  drawDepthVolume(
+    ViewOfCpuInterleavedFrameBuffer<blockSize> dest, int destx, int desty,
+    ViewOfCpuDepthVolume src, int16_t srcdepthbias,
+    Function<uint32_t(uint32_t destArgb, uint8_t thickness)> auto &&argbFromThickness)
+  {
+    const int minsy = clipMin(desty, dest.h, src.h);
+    const int maxsy = clipMax(desty, dest.h, src.h);
+    const int minsx = clipMin(destx, dest.w, src.w);
+    const int maxsx = clipMax(destx, dest.w, src.w);
+
+    if (minsx >= maxsx || minsy >= maxsy)
+      return;
+
+    for (int sy = minsy; sy < maxsy; ++sy)
+    {
+      const uint16_t *psrc = src.depthAndThickness + sy * src.w;
+      InterleavedPixelBlock<blockSize> *row = dest.row(desty + sy);
+
+      detail::forEachBlockSpan<blockSize>(
+        destx + minsx, destx + maxsx,
+        [&](int block, int lane, int x, int n)
+        {
+          detail::drawDepthVolumeRow(psrc + (x - destx), row[block].depth + lane, row[block].argb + lane, n, srcdepthbias, argbFromThickness);
+        });
+    }
+  }
+}
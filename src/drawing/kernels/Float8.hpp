@@ -0,0 +1,169 @@
+#pragma once
+
+// 8 floats for the packet kernels (packets.hpp): one AVX register, two SSE or NEON registers, or an array otherwise, so
+// that each kernel is written once with the arithmetic they all have; only included by define.hpp.
+// Every operation rounds as the scalar one does (and min and max are glm's), and CMakeLists.txt keeps the compiler from
+// fusing or reordering them, so the kernels of every instruction set give the same results.
+
+#if defined(__AVX2__)
+struct Float8 {__m256 v;};
+struct Mask8 {__m256 v;}; // all bits set in lanes which are true
+
+static Float8 load8(const float *p) {return {_mm256_loadu_ps(p)};}
+static void store8(float *p, Float8 a) {_mm256_storeu_ps(p, a.v);}
+static Float8 splat8(float x) {return {_mm256_set1_ps(x)};}
+
+static Float8 operator+(Float8 a, Float8 b) {return {_mm256_add_ps(a.v, b.v)};}
+static Float8 operator-(Float8 a, Float8 b) {return {_mm256_sub_ps(a.v, b.v)};}
+static Float8 operator*(Float8 a, Float8 b) {return {_mm256_mul_ps(a.v, b.v)};}
+static Float8 operator/(Float8 a, Float8 b) {return {_mm256_div_ps(a.v, b.v)};}
+static Float8 operator-(Float8 a) {return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.f))};}
+
+static Mask8 operator<(Float8 a, Float8 b) {return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)};}
+static Mask8 operator<=(Float8 a, Float8 b) {return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)};}
+static Mask8 operator>(Float8 a, Float8 b) {return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};}
+static Mask8 operator>=(Float8 a, Float8 b) {return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)};}
+static Mask8 operator&(Mask8 a, Mask8 b) {return {_mm256_and_ps(a.v, b.v)};}
+static Mask8 operator|(Mask8 a, Mask8 b) {return {_mm256_or_ps(a.v, b.v)};}
+
+static Float8 select(Mask8 m, Float8 a, Float8 b) {return {_mm256_blendv_ps(b.v, a.v, m.v)};}
+static uint32_t bits(Mask8 m) {return (uint32_t)_mm256_movemask_ps(m.v);}
+
+static Float8 floor(Float8 a) {return {_mm256_floor_ps(a.v)};}
+static Float8 sqrt(Float8 a) {return {_mm256_sqrt_ps(a.v)};}
+static Float8 abs(Float8 a) {return {_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v)};}
+#elif defined(__SSE4_1__)
+struct Float8 {__m128 lo, hi;};
+struct Mask8 {__m128 lo, hi;}; // all bits set in lanes which are true
+
+static Float8 load8(const float *p) {return {_mm_loadu_ps(p), _mm_loadu_ps(p + 4)};}
+static void store8(float *p, Float8 a) {(_mm_storeu_ps(p, a.lo), _mm_storeu_ps(p + 4, a.hi));}
+static Float8 splat8(float x) {return {_mm_set1_ps(x), _mm_set1_ps(x)};}
+
+static Float8 operator+(Float8 a, Float8 b) {return {_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)};}
+static Float8 operator-(Float8 a, Float8 b) {return {_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)};}
+static Float8 operator*(Float8 a, Float8 b) {return {_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)};}
+static Float8 operator/(Float8 a, Float8 b) {return {_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)};}
+static Float8 operator-(Float8 a) {return {_mm_xor_ps(a.lo, _mm_set1_ps(-0.f)), _mm_xor_ps(a.hi, _mm_set1_ps(-0.f))};}
+
+static Mask8 operator<(Float8 a, Float8 b) {return {_mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi)};}
+static Mask8 operator<=(Float8 a, Float8 b) {return {_mm_cmple_ps(a.lo, b.lo), _mm_cmple_ps(a.hi, b.hi)};}
+static Mask8 operator>(Float8 a, Float8 b) {return {_mm_cmpgt_ps(a.lo, b.lo), _mm_cmpgt_ps(a.hi, b.hi)};}
+static Mask8 operator>=(Float8 a, Float8 b) {return {_mm_cmpge_ps(a.lo, b.lo), _mm_cmpge_ps(a.hi, b.hi)};}
+static Mask8 operator&(Mask8 a, Mask8 b) {return {_mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi)};}
+static Mask8 operator|(Mask8 a, Mask8 b) {return {_mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi)};}
+
+static Float8 select(Mask8 m, Float8 a, Float8 b) {return {_mm_blendv_ps(b.lo, a.lo, m.lo), _mm_blendv_ps(b.hi, a.hi, m.hi)};}
+static uint32_t bits(Mask8 m) {return (uint32_t)(_mm_movemask_ps(m.lo) | _mm_movemask_ps(m.hi) << 4);}
+
+static Float8 floor(Float8 a) {return {_mm_floor_ps(a.lo), _mm_floor_ps(a.hi)};}
+static Float8 sqrt(Float8 a) {return {_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)};}
+static Float8 abs(Float8 a) {return {_mm_andnot_ps(_mm_set1_ps(-0.f), a.lo), _mm_andnot_ps(_mm_set1_ps(-0.f), a.hi)};}
+#elif defined(DRAWING_KERNELS_NEON)
+struct Float8 {float32x4_t lo, hi;};
+struct Mask8 {uint32x4_t lo, hi;}; // all bits set in lanes which are true
+
+static Float8 load8(const float *p) {return {vld1q_f32(p), vld1q_f32(p + 4)};}
+static void store8(float *p, Float8 a) {(vst1q_f32(p, a.lo), vst1q_f32(p + 4, a.hi));}
+static Float8 splat8(float x) {return {vdupq_n_f32(x), vdupq_n_f32(x)};}
+
+static Float8 operator+(Float8 a, Float8 b) {return {vaddq_f32(a.lo, b.lo), vaddq_f32(a.hi, b.hi)};}
+static Float8 operator-(Float8 a, Float8 b) {return {vsubq_f32(a.lo, b.lo), vsubq_f32(a.hi, b.hi)};}
+static Float8 operator*(Float8 a, Float8 b) {return {vmulq_f32(a.lo, b.lo), vmulq_f32(a.hi, b.hi)};}
+static Float8 operator/(Float8 a, Float8 b) {return {vdivq_f32(a.lo, b.lo), vdivq_f32(a.hi, b.hi)};}
+static Float8 operator-(Float8 a) {return {vnegq_f32(a.lo), vnegq_f32(a.hi)};}
+
+static Mask8 operator<(Float8 a, Float8 b) {return {vcltq_f32(a.lo, b.lo), vcltq_f32(a.hi, b.hi)};}
+static Mask8 operator<=(Float8 a, Float8 b) {return {vcleq_f32(a.lo, b.lo), vcleq_f32(a.hi, b.hi)};}
+static Mask8 operator>(Float8 a, Float8 b) {return {vcgtq_f32(a.lo, b.lo), vcgtq_f32(a.hi, b.hi)};}
+static Mask8 operator>=(Float8 a, Float8 b) {return {vcgeq_f32(a.lo, b.lo), vcgeq_f32(a.hi, b.hi)};}
+static Mask8 operator&(Mask8 a, Mask8 b) {return {vandq_u32(a.lo, b.lo), vandq_u32(a.hi, b.hi)};}
+static Mask8 operator|(Mask8 a, Mask8 b) {return {vorrq_u32(a.lo, b.lo), vorrq_u32(a.hi, b.hi)};}
+
+static Float8 select(Mask8 m, Float8 a, Float8 b) {return {vbslq_f32(m.lo, a.lo, b.lo), vbslq_f32(m.hi, a.hi, b.hi)};}
+
+static uint32_t
+bits(Mask8 m)
+{
+  static const uint32_t lanes[4] = {1, 2, 4, 8};
+  const uint32x4_t weights = vld1q_u32(lanes);
+  return vaddvq_u32(vandq_u32(m.lo, weights)) | vaddvq_u32(vandq_u32(m.hi, weights)) << 4;
+}
+
+static Float8 floor(Float8 a) {return {vrndmq_f32(a.lo), vrndmq_f32(a.hi)};}
+static Float8 sqrt(Float8 a) {return {vsqrtq_f32(a.lo), vsqrtq_f32(a.hi)};}
+static Float8 abs(Float8 a) {return {vabsq_f32(a.lo), vabsq_f32(a.hi)};}
+#else
+struct Float8 {float v[8];};
+struct Mask8 {bool v[8];};
+
+// each lane of f(lanes of args...)
+template<class R = Float8>
+static R
+lanes8(auto &&f, auto... args)
+{
+  R r;
+
+  for (int i = 0; i < 8; ++i)
+    r.v[i] = f(args.v[i]...);
+
+  return r;
+}
+
+static Float8 load8(const float *p) {Float8 r; std::copy_n(p, 8, r.v); return r;}
+static void store8(float *p, Float8 a) {std::copy_n(a.v, 8, p);}
+static Float8 splat8(float x) {Float8 r; std::fill_n(r.v, 8, x); return r;}
+
+static Float8 operator+(Float8 a, Float8 b) {return lanes8([](float x, float y) {return x + y;}, a, b);}
+static Float8 operator-(Float8 a, Float8 b) {return lanes8([](float x, float y) {return x - y;}, a, b);}
+static Float8 operator*(Float8 a, Float8 b) {return lanes8([](float x, float y) {return x * y;}, a, b);}
+static Float8 operator/(Float8 a, Float8 b) {return lanes8([](float x, float y) {return x / y;}, a, b);}
+static Float8 operator-(Float8 a) {return lanes8([](float x) {return -x;}, a);}
+
+static Mask8 operator<(Float8 a, Float8 b) {return lanes8<Mask8>([](float x, float y) {return x < y;}, a, b);}
+static Mask8 operator<=(Float8 a, Float8 b) {return lanes8<Mask8>([](float x, float y) {return x <= y;}, a, b);}
+static Mask8 operator>(Float8 a, Float8 b) {return lanes8<Mask8>([](float x, float y) {return x > y;}, a, b);}
+static Mask8 operator>=(Float8 a, Float8 b) {return lanes8<Mask8>([](float x, float y) {return x >= y;}, a, b);}
+static Mask8 operator&(Mask8 a, Mask8 b) {return lanes8<Mask8>([](bool x, bool y) {return x & y;}, a, b);}
+static Mask8 operator|(Mask8 a, Mask8 b) {return lanes8<Mask8>([](bool x, bool y) {return x | y;}, a, b);}
+
+static Float8 select(Mask8 m, Float8 a, Float8 b) {return lanes8([](bool c, float x, float y) {return c ? x : y;}, m, a, b);}
+
+static uint32_t
+bits(Mask8 m)
+{
+  uint32_t r = 0;
+
+  for (int i = 0; i < 8; ++i)
+    r |= uint32_t(m.v[i]) << i;
+
+  return r;
+}
+
+static Float8 floor(Float8 a) {return lanes8([](float x) {return std::floor(x);}, a);}
+static Float8 sqrt(Float8 a) {return lanes8([](float x) {return std::sqrt(x);}, a);}
+static Float8 abs(Float8 a) {return lanes8([](float x) {return std::abs(x);}, a);}
+#endif
+
+// with a float for either operand
+static Float8 operator+(Float8 a, float b) {return a + splat8(b);}
+static Float8 operator-(Float8 a, float b) {return a - splat8(b);}
+static Float8 operator*(Float8 a, float b) {return a * splat8(b);}
+static Float8 operator/(Float8 a, float b) {return a / splat8(b);}
+static Float8 operator-(float a, Float8 b) {return splat8(a) - b;}
+static Float8 operator*(float a, Float8 b) {return splat8(a) * b;}
+static Float8 operator/(float a, Float8 b) {return splat8(a) / b;}
+static Mask8 operator<=(Float8 a, float b) {return a <= splat8(b);}
+static Mask8 operator>(Float8 a, float b) {return a > splat8(b);}
+static Mask8 operator>=(Float8 a, float b) {return a >= splat8(b);}
+
+static Float8 &operator+=(Float8 &a, auto b) {return a = a + b;}
+static Float8 &operator-=(Float8 &a, auto b) {return a = a - b;}
+static Float8 &operator*=(Float8 &a, auto b) {return a = a * b;}
+
+static Float8 select(Mask8 m, float a, float b) {return select(m, splat8(a), splat8(b));}
+
+// as glm::min and glm::max
+static Float8 min(Float8 a, Float8 b) {return select(b < a, b, a);}
+static Float8 max(Float8 a, Float8 b) {return select(a < b, b, a);}
+static Float8 max(Float8 a, float b) {return max(a, splat8(b));}
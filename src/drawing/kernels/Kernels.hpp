@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define DRAWING_KERNELS_X86 1
+#else
+#define DRAWING_KERNELS_X86 0
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define DRAWING_KERNELS_ARM64 1
+#else
+#define DRAWING_KERNELS_ARM64 0
+#endif
+
+namespace drawing::kernels
+{
+  // The lanes of a raycasting::RayPacket and IntersectionPacket which the packet kernels below read and write (lanes()
+  // of those), and the parameters of the shapes they intersect (see raycasting/shapes), without glm.
+  struct RayLanes {const float *ox, *oy, *oz; float dx, dy, dz;};
+  struct IntersectionLanes {float *px, *py, *pz, *nx, *ny, *nz, *distance;};
+  struct SphereParameters {float cx, cy, cz, sqradius;};
+  struct QuadParameters {float cx, cy, cz, nx, ny, nz, ax, ay, az, bx, by, bz, al2, bl2;};
+  struct ConeParameters {float sqradius, minz, maxz, zslope;};
+
+  // The innermost loops of drawing, and of baking the sprites which are drawn, for one instruction set. There is a table
+  // of them for each instruction set, built by the translation unit of the same name in this directory with that
+  // instruction set enabled (see CMakeLists.txt), and the fastest one the CPU supports is chosen when the program starts
+  // (see active.hpp), so that one binary runs at full speed on every CPU.
+  struct Kernels
+  {
+    const char *name;
+
+    // depth-tests and draws one row of drawWithDepth; returns the number of pixels written
+    int (*drawRowWithDepth)(const uint32_t *psrc, uint32_t *pdestimage, int16_t *pdestdepth, int width, int16_t srcdepthbias);
+
+    // depth-tests and draws a span of drawSparseWithDepth, which has no transparent pixels; returns the number written
+    int (*drawOpaqueSpanWithDepth)(const uint32_t *psrc, uint32_t *pdestimage, int16_t *pdestdepth, int width, int16_t srcdepthbias);
+
+    // draws one row of drawWithoutDepth
+    void (*drawRowWithoutDepth)(const uint32_t *psrc, uint32_t *pdestimage, int width);
+
+    // index of the first or last pixel in [begin, end) of row which isn't transparent (depth 255), or end or begin - 1 if
+    // there is none; for measureImageBounds
+    int (*firstOpaque)(const uint32_t *row, int begin, int end);
+    int (*lastOpaque)(const uint32_t *row, int begin, int end);
+
+    // streaming stores, which bypass the cache: for whole frame buffers which won't be read again soon
+    void (*fillArgb)(uint32_t *dst, size_t n, uint32_t val);
+    void (*fillDepth)(int16_t *dst, size_t n, int16_t val);
+
+    // Draws as much of one row of drawDepthVolume with blending::MixArgbConst1{argb1} as this instruction set can (whole
+    // blocks of 8 pixels with AVX2 or NEON, all of it with AVX-512, none otherwise); returns the number of pixels
+    // drawn, which the caller draws the rest of.
+    int (*drawDepthVolumeRowMixArgbConst1)(
+      const uint16_t *psrc, int16_t *pdestdepth, uint32_t *pdestargb, int width, int16_t srcdepthbias, uint32_t argb1);
+
+    // the packet intersect of the raycasting shapes for 8 rays; return the bits of the lanes which intersected
+    uint32_t (*intersectSphere8)(const SphereParameters &sphere, const RayLanes &rays, const IntersectionLanes &intersections);
+    uint32_t (*intersectQuad8)(const QuadParameters &quad, const RayLanes &rays, const IntersectionLanes &intersections);
+    uint32_t (*intersectCone8)(const ConeParameters &cone, const RayLanes &rays, const IntersectionLanes &intersections);
+
+    // noise::perlin8: gradient noise of 8 points
+    void (*perlin8)(const float *x, const float *y, const float *z, float *out);
+
+    // gradient::GradientTable::lookup8: entries of r, g and b nearest 8 values of t (with gathers where there are any)
+    void (*lookupGradient8)(
+      const float *r, const float *g, const float *b, int entries, const float *t, float *outr, float *outg, float *outb);
+  };
+
+  namespace scalar {extern const Kernels table;}
+#if DRAWING_KERNELS_X86
+  namespace sse41 {extern const Kernels table;}
+  namespace avx2 {extern const Kernels table;}
+  namespace avx512bw {extern const Kernels table;}
+#elif DRAWING_KERNELS_ARM64
+  namespace neon {extern const Kernels table;}
+#endif
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <CpuFeatures.hpp>
+
+#include "Kernels.hpp"
+
+// Not included by the kernels' own translation units: what they include is compiled for their instruction set, which
+// the initialization of activeKernels mustn't be.
+namespace drawing::kernels
+{
+  // the tables this CPU can run, slowest first
+  inline
+  std::vector<const Kernels *>
+  supported()
+  {
+    std::vector<const Kernels *> tables{&scalar::table};
+
+#if DRAWING_KERNELS_X86
+    const CpuFeatures cpu = CpuFeatures::detect();
+
+    if (cpu.sse41)
+      tables.push_back(&sse41::table);
+
+    if (cpu.avx2)
+      tables.push_back(&avx2::table);
+
+    if (cpu.avx512bw)
+      tables.push_back(&avx512bw::table);
+#elif DRAWING_KERNELS_ARM64
+    tables.push_back(&neon::table); // every ARM64 CPU has NEON
+#endif
+
+    return tables;
+  }
+
+  // the supported table with this name, or nullptr
+  inline
+  const Kernels *
+  find(std::string_view name)
+  {
+    for (const Kernels *table: supported())
+      if (table->name == name)
+        return table;
+
+    return nullptr;
+  }
+
+  // The fastest supported table, unless the environment variable DRAWING_KERNELS names another supported one
+  // (scalar, sse4.1, avx2, avx512bw or neon), e.g. to compare them.
+  inline
+  const Kernels &
+  choose()
+  {
+    if (const char *name = std::getenv("DRAWING_KERNELS"))
+    {
+      if (const Kernels *table = find(name))
+        return *table;
+
+      std::cerr << "DRAWING_KERNELS=" << name << " is not supported by this CPU, using the fastest that is" << std::endl;
+    }
+
+    return *supported().back();
+  }
+
+  // (the functions here are inline rather than static so that this, which every translation unit shares, is only
+  // initialized from entities with external linkage)
+  namespace detail
+  {
+    inline const Kernels *activeKernels = &choose();
+  }
+
+  // the table the drawing functions use
+  inline
+  const Kernels &
+  active()
+  {
+    return *detail::activeKernels;
+  }
+
+  // Makes the drawing functions use the supported table with this name from now on; not thread safe.
+  inline
+  void
+  use(std::string_view name)
+  {
+    const Kernels *table = find(name);
+
+    if (!table)
+      throw std::runtime_error("drawing kernels not supported by this CPU: " + std::string{name});
+
+    detail::activeKernels = table;
+  }
+}
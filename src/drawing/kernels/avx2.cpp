@@ -0,0 +1,5 @@
+// Drawing kernels for x86 CPUs with AVX2: CMakeLists.txt compiles this with -mavx2 (/arch:AVX2 with MSVC).
+
+#define KERNELS_NAMESPACE avx2
+#define KERNELS_NAME "avx2"
+#include "define.hpp"
@@ -0,0 +1,6 @@
+// Drawing kernels for x86 CPUs with AVX-512 F, DQ, BW and VL: CMakeLists.txt compiles this with -mavx512f -mavx512dq
+// -mavx512bw -mavx512vl (/arch:AVX512 with MSVC).
+
+#define KERNELS_NAMESPACE avx512bw
+#define KERNELS_NAME "avx512bw"
+#include "define.hpp"
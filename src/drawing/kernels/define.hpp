@@ -0,0 +1,50 @@
+// Defines KERNELS_NAMESPACE::table (see Kernels.hpp) from the kernels compiled for the instruction set of the
+// translation unit including this, which defines KERNELS_NAMESPACE and KERNELS_NAME first.
+//
+// The inline functions of the headers the kernels use are compiled for that instruction set too, and the linker could
+// pick those over the same functions compiled for the baseline instruction set by other translation units (as it may
+// when they aren't inlined, e.g. in debug builds). So the headers of this project are included inside
+// KERNELS_NAMESPACE, making their functions distinct, after the standard and intrinsics headers they include (which
+// then aren't included again inside it), and the kernels of instruction sets beyond the baseline don't call the
+// standard library's functions.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "Kernels.hpp"
+
+#if DRAWING_KERNELS_X86
+#include <immintrin.h>
+#elif DRAWING_KERNELS_ARM64
+#include <arm_neon.h>
+#endif
+
+namespace drawing::kernels::KERNELS_NAMESPACE
+{
+#include <fillFast.hpp>
+#include "../blending/MixArgb.hpp"
+#include "../drawDepthVolumeRow8.hpp"
+#include "rows.hpp"
+#include "Float8.hpp"
+#include "packets.hpp"
+
+  const Kernels table{
+    .name = KERNELS_NAME,
+    .drawRowWithDepth = drawRowWithDepth,
+    .drawOpaqueSpanWithDepth = drawOpaqueSpanWithDepth,
+    .drawRowWithoutDepth = drawRowWithoutDepth,
+    .firstOpaque = firstOpaque,
+    .lastOpaque = lastOpaque,
+    .fillArgb = fillFast,
+    .fillDepth = fillFast,
+    .drawDepthVolumeRowMixArgbConst1 = drawDepthVolumeRowMixArgbConst1,
+    .intersectSphere8 = intersectSphere8,
+    .intersectQuad8 = intersectQuad8,
+    .intersectCone8 = intersectCone8,
+    .perlin8 = perlin8,
+    .lookupGradient8 = lookupGradient8};
+}
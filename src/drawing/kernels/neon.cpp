@@ -0,0 +1,10 @@
+// Drawing kernels for ARM64 CPUs, all of which have NEON.
+
+// NEON is part of the baseline instruction set on ARM64, so the compilers allow it in every translation unit (MSVC
+// without defining __ARM_NEON). The kernels only use it where this is defined, so that the scalar kernels stay plain C++,
+// to compare with.
+#define DRAWING_KERNELS_NEON 1
+
+#define KERNELS_NAMESPACE neon
+#define KERNELS_NAME "neon"
+#include "define.hpp"
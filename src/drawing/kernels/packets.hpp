@@ -0,0 +1,191 @@
+#pragma once
+
+// The packet kernels of Kernels, for baking sprites: 8 rays or points at a time in Float8s, for whatever instruction set
+// this is compiled for; only included by define.hpp.
+
+static auto sq(auto x) {return x * x;}
+
+// same as raycasting::shapes::detail::Sphere::intersect(Ray) for each lane
+static uint32_t
+intersectSphere8(const SphereParameters &sphere, const RayLanes &rays, const IntersectionLanes &intersections)
+{
+  const float dx = rays.dx, dy = rays.dy, dz = rays.dz;
+  const Float8 ox = load8(rays.ox), oy = load8(rays.oy), oz = load8(rays.oz);
+
+  const Float8 omcx = ox - sphere.cx, omcy = oy - sphere.cy, omcz = oz - sphere.cz;
+  const Float8 ray_dot_originMinusCenter = dx * omcx + dy * omcy + dz * omcz;
+  const Float8 insideRadical = sq(ray_dot_originMinusCenter) - (sq(omcx) + sq(omcy) + sq(omcz)) + sphere.sqradius;
+  const Float8 t = -ray_dot_originMinusCenter - sqrt(max(insideRadical, 0.f));
+
+  const Float8 px = ox + t * dx, py = oy + t * dy, pz = oz + t * dz;
+  const Float8 invLength = 1.f / sqrt(sq(px - sphere.cx) + sq(py - sphere.cy) + sq(pz - sphere.cz));
+
+  store8(intersections.px, px);
+  store8(intersections.py, py);
+  store8(intersections.pz, pz);
+  store8(intersections.nx, (px - sphere.cx) * invLength);
+  store8(intersections.ny, (py - sphere.cy) * invLength);
+  store8(intersections.nz, (pz - sphere.cz) * invLength);
+  store8(intersections.distance, t);
+
+  return bits(insideRadical > 0.f);
+}
+
+// same as raycasting::shapes::detail::Quad::intersect(Ray) for each lane
+static uint32_t
+intersectQuad8(const QuadParameters &quad, const RayLanes &rays, const IntersectionLanes &intersections)
+{
+  constexpr const float small = 0.001f;
+
+  const float dx = rays.dx, dy = rays.dy, dz = rays.dz;
+  const float dDotN = dx * quad.nx + dy * quad.ny + dz * quad.nz;
+
+  if (dDotN > -small && dDotN < small)
+    return 0; // all rays share a direction, so all are parallel with the plane
+
+  const Float8 ox = load8(rays.ox), oy = load8(rays.oy), oz = load8(rays.oz);
+  const Float8 t = ((quad.cx - ox) * quad.nx + (quad.cy - oy) * quad.ny + (quad.cz - oz) * quad.nz) / dDotN;
+
+  const Float8 px = ox + t * dx, py = oy + t * dy, pz = oz + t * dz;
+  const Float8 rx = px - quad.cx, ry = py - quad.cy, rz = pz - quad.cz;
+  const Mask8 inA = abs(rx * quad.ax + ry * quad.ay + rz * quad.az) <= quad.al2;
+  const Mask8 inB = abs(rx * quad.bx + ry * quad.by + rz * quad.bz) <= quad.bl2;
+
+  store8(intersections.px, px);
+  store8(intersections.py, py);
+  store8(intersections.pz, pz);
+  store8(intersections.nx, splat8(quad.nx));
+  store8(intersections.ny, splat8(quad.ny));
+  store8(intersections.nz, splat8(quad.nz));
+  store8(intersections.distance, t);
+
+  return bits(inA & inB);
+}
+
+// same as raycasting::shapes::detail::Cone::intersect(Ray) for each lane
+static uint32_t
+intersectCone8(const ConeParameters &cone, const RayLanes &rays, const IntersectionLanes &intersections)
+{
+  constexpr float small = 0.0005f;
+
+  const float dx = rays.dx, dy = rays.dy, dz = rays.dz;
+  const float a = sq(dx) + sq(dy) - cone.sqradius * sq(dz);
+
+  if (a > -small && a < small)
+    return 0; // a only depends on the shared direction
+
+  const float two_a = a + a;
+  const Float8 ox = load8(rays.ox), oy = load8(rays.oy), oz = load8(rays.oz);
+
+  const Float8 b = 2.f * (ox * dx + oy * dy - cone.sqradius * oz * dz);
+  const Float8 c = sq(ox) + sq(oy) - cone.sqradius * sq(oz);
+  const Float8 bb_minus_four_ac = sq(b) - two_a * (c + c);
+  const Float8 sqrtDiscriminant = sqrt(max(bb_minus_four_ac, 0.f));
+
+  const Float8 ta = (-b - sqrtDiscriminant) / two_a, tb = (-b + sqrtDiscriminant) / two_a;
+  const Float8 t0 = min(ta, tb), t1 = max(ta, tb);
+  const Float8 z0 = oz + t0 * dz, z1 = oz + t1 * dz;
+  const Mask8 in0 = (z0 >= cone.minz) & (z0 <= cone.maxz);
+  const Mask8 in1 = (z1 >= cone.minz) & (z1 <= cone.maxz);
+  const Float8 t = select(in0, t0, t1);
+
+  const Float8 px = ox + t * dx, py = oy + t * dy, pz = oz + t * dz;
+  const Float8 invLengthXy = 1.f / sqrt(sq(px) + sq(py));
+  const Float8 nx = px * invLengthXy, ny = py * invLengthXy;
+  const Float8 invLength = 1.f / sqrt(sq(nx) + sq(ny) + sq(cone.zslope));
+
+  store8(intersections.px, px);
+  store8(intersections.py, py);
+  store8(intersections.pz, pz);
+  store8(intersections.nx, nx * invLength);
+  store8(intersections.ny, ny * invLength);
+  store8(intersections.nz, cone.zslope * invLength);
+  store8(intersections.distance, t);
+
+  return bits((bb_minus_four_ac >= 0.f) & (in0 | in1));
+}
+
+// noise::perlin8 (see perlin8.hpp)
+static void
+perlin8(const float *x, const float *y, const float *z, float *out)
+{
+  auto mod289 = [](Float8 v) {return v - floor(v * (1.f / 289.f)) * 289.f;};
+  auto permute = [&](Float8 v) {return mod289((v * 34.f + 1.f) * v);};
+  auto fract = [](Float8 v) {return v - floor(v);};
+  auto taylorInvSqrt = [](Float8 r) {return 1.79284291400159f - 0.85373472095314f * r;};
+  auto fade = [](Float8 t) {return t * t * t * (t * (t * 6.f - 15.f) + 10.f);};
+  auto mix = [](Float8 a, Float8 b, Float8 t) {return a * (1.f - t) + b * t;};
+
+  // gradient for hash h, as glm does it: x and y from h's base 7 digits, z from the rest of the octahedron
+  auto gradient = [&](Float8 h, Float8 &gx, Float8 &gy, Float8 &gz)
+  {
+    gx = h * (1.f / 7.f);
+    gy = fract(floor(gx) * (1.f / 7.f)) - 0.5f;
+    gx = fract(gx);
+    gz = 0.5f - abs(gx) - abs(gy);
+
+    const Float8 sz = select(gz <= 0.f, 1.f, 0.f);
+    gx -= sz * (select(gx >= 0.f, 1.f, 0.f) - 0.5f);
+    gy -= sz * (select(gy >= 0.f, 1.f, 0.f) - 0.5f);
+
+    const Float8 norm = taylorInvSqrt(gx * gx + gy * gy + gz * gz);
+    (gx *= norm, gy *= norm, gz *= norm);
+  };
+
+  const Float8 x8 = load8(x), y8 = load8(y), z8 = load8(z);
+  const Float8 fx = floor(x8), fy = floor(y8), fz = floor(z8);
+
+  // integer cell corners, and position within the cell relative to each corner
+  const Float8 ix0 = mod289(fx), iy0 = mod289(fy), iz0 = mod289(fz);
+  const Float8 ix1 = mod289(fx + 1.f), iy1 = mod289(fy + 1.f), iz1 = mod289(fz + 1.f);
+  const Float8 px0 = x8 - fx, py0 = y8 - fy, pz0 = z8 - fz;
+  const Float8 px1 = px0 - 1.f, py1 = py0 - 1.f, pz1 = pz0 - 1.f;
+
+  const Float8 hx0 = permute(ix0), hx1 = permute(ix1);
+  const Float8 hxy00 = permute(hx0 + iy0), hxy10 = permute(hx1 + iy0);
+  const Float8 hxy01 = permute(hx0 + iy1), hxy11 = permute(hx1 + iy1);
+
+  // contribution of corner xyz: its gradient dotted with the position relative to it
+  auto corner = [&](Float8 hxy, Float8 iz, Float8 px, Float8 py, Float8 pz)
+  {
+    Float8 gx, gy, gz;
+    gradient(permute(hxy + iz), gx, gy, gz);
+    return gx * px + gy * py + gz * pz;
+  };
+
+  const Float8 n000 = corner(hxy00, iz0, px0, py0, pz0), n100 = corner(hxy10, iz0, px1, py0, pz0);
+  const Float8 n010 = corner(hxy01, iz0, px0, py1, pz0), n110 = corner(hxy11, iz0, px1, py1, pz0);
+  const Float8 n001 = corner(hxy00, iz1, px0, py0, pz1), n101 = corner(hxy10, iz1, px1, py0, pz1);
+  const Float8 n011 = corner(hxy01, iz1, px0, py1, pz1), n111 = corner(hxy11, iz1, px1, py1, pz1);
+
+  const Float8 u = fade(px0), v = fade(py0), w = fade(pz0);
+
+  const Float8 nx00 = mix(n000, n001, w), nx10 = mix(n100, n101, w);
+  const Float8 nx01 = mix(n010, n011, w), nx11 = mix(n110, n111, w);
+
+  store8(out, 2.2f * mix(mix(nx00, nx01, v), mix(nx10, nx11, v), u));
+}
+
+// gradient::GradientTable::lookup8 (see makeGradient.hpp): the entries of r, g and b nearest each t
+static void
+lookupGradient8(
+  const float *r, const float *g, const float *b, int entries, const float *t, float *outr, float *outg, float *outb)
+{
+#if defined(__AVX2__)
+  Float8 t8 = load8(t);
+  t8 = select(t8 > 0.f, select(t8 < splat8(1.f), t8, splat8(1.f)), splat8(0.f)); // written so that NaN gives 0
+  const __m256i i = _mm256_cvttps_epi32((t8 * (float)(entries - 1) + 0.5f).v);
+
+  _mm256_storeu_ps(outr, _mm256_i32gather_ps(r, i, 4));
+  _mm256_storeu_ps(outg, _mm256_i32gather_ps(g, i, 4));
+  _mm256_storeu_ps(outb, _mm256_i32gather_ps(b, i, 4));
+#else
+  // no gathers: a lane at a time
+  for (int lane = 0; lane < 8; ++lane)
+  {
+    const float tl = t[lane] > 0.f ? (t[lane] < 1.f ? t[lane] : 1.f) : 0.f;
+    const int i = (int)(tl * (float)(entries - 1) + 0.5f);
+    (outr[lane] = r[i], outg[lane] = g[i], outb[lane] = b[i]);
+  }
+#endif
+}
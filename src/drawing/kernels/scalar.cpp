@@ -0,0 +1,6 @@
+// Drawing kernels for any CPU: compiled for the baseline instruction set, and the only ones other than on x86 and
+// ARM64.
+
+#define KERNELS_NAMESPACE scalar
+#define KERNELS_NAME "scalar"
+#include "define.hpp"
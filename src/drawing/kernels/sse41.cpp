@@ -0,0 +1,10 @@
+// Drawing kernels for x86 CPUs with SSE4.1: CMakeLists.txt compiles this with -msse4.1.
+
+// MSVC has no option for SSE4.1, whose intrinsics it always allows, so doesn't define this
+#if defined(_MSC_VER) && !defined(__SSE4_1__)
+#define __SSE4_1__ 1
+#endif
+
+#define KERNELS_NAMESPACE sse41
+#define KERNELS_NAME "sse4.1"
+#include "define.hpp"
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+
+#include <function_traits.hpp>
+
+#include "../CpuFrameBuffer.hpp"
+#include "../DepthPyramid.hpp"
+
+namespace drawing
+{
+  // True if nothing with depth >= srcMinDepth can pass the depth test anywhere in the destination rectangle
+  // [minx, maxx) x [miny, maxy), judging only by the coarse depth of dest.
+  // Always false if dest has no depth pyramid.
+  static bool
+  isOccluded(const ViewOfCpuFrameBuffer &dest, int minx, int miny, int maxx, int maxy, int srcMinDepth)
+  {
+    using P = ViewOfDepthPyramid;
+
+    if (!dest.hiz)
+      return false;
+
+    for (int sy = miny >> P::superBlockShift; sy <= (maxy - 1) >> P::superBlockShift; ++sy)
+      for (int sx = minx >> P::superBlockShift; sx <= (maxx - 1) >> P::superBlockShift; ++sx)
+        if (dest.hiz.superBlockMax[sy * dest.hiz.superPitch + sx] > srcMinDepth)
+          return false;
+
+    return true;
+  }
+
+  namespace detail
+  {
+    // Calls drawRect(minx, miny, maxx, maxy) for the parts of the (already clipped) destination rectangle which
+    // are not occluded for something with depth >= srcMinDepth, as runs of blocks within bands of block rows,
+    // then tightens the depth pyramid of dest over the blocks which were drawn.
+    // Without a depth pyramid this simply draws the whole rectangle.
+    // With lazy clearing, only blocks which are drawn to get cleared, each just before it is drawn.
+    static void
+    drawUnoccluded(
+      const ViewOfCpuFrameBuffer &dest, int minx, int miny, int maxx, int maxy, int srcMinDepth,
+      Function<void(int minx, int miny, int maxx, int maxy)> auto &&drawRect)
+    {
+      using P = ViewOfDepthPyramid;
+
+      if (!dest.hiz)
+      {
+        dest.finishClear(minx, miny, maxx, maxy);
+        drawRect(minx, miny, maxx, maxy);
+        return;
+      }
+
+      if (isOccluded(dest, minx, miny, maxx, maxy, srcMinDepth))
+        return;
+
+      const ViewOfDepthPyramid &hiz = dest.hiz;
+      const int minbx = minx >> P::blockShift, maxbx = ((maxx - 1) >> P::blockShift) + 1;
+      bool updatedAny = false;
+
+      for (int by = miny >> P::blockShift; by <= (maxy - 1) >> P::blockShift; ++by)
+      {
+        const int bandMinY = std::max(miny, by << P::blockShift);
+        const int bandMaxY = std::min(maxy, (by + 1) << P::blockShift);
+
+        // only blocks whose every row is drawn get tightened, so as not to read depth rows which aren't already in cache
+        const bool wholeBand = bandMinY == by << P::blockShift && bandMaxY == std::min(dest.h, (by + 1) << P::blockShift);
+
+        const int16_t *blockMax = hiz.blockMax + by * hiz.pitch;
+
+        for (int bx = minbx; bx < maxbx;)
+        {
+          if (blockMax[bx] <= srcMinDepth)
+          {
+            ++bx;
+            continue;
+          }
+
+          int runEnd = bx + 1;
+          while (runEnd < maxbx && blockMax[runEnd] > srcMinDepth)
+            ++runEnd;
+
+          const int runMinX = std::max(minx, bx << P::blockShift), runMaxX = std::min(maxx, runEnd << P::blockShift);
+          dest.finishClear(runMinX, bandMinY, runMaxX, bandMaxY);
+          drawRect(runMinX, bandMinY, runMaxX, bandMaxY);
+
+          if (wholeBand)
+          {
+            for (int b = bx; b < runEnd; ++b)
+              hiz.updateBlock(b, by, dest.depth, dest.pitch, dest.w, dest.h);
+            updatedAny = true;
+          }
+
+          bx = runEnd;
+        }
+      }
+
+      if (updatedAny)
+        for (int sy = miny >> P::superBlockShift; sy <= (maxy - 1) >> P::superBlockShift; ++sy)
+          for (int sx = minx >> P::superBlockShift; sx <= (maxx - 1) >> P::superBlockShift; ++sx)
+            hiz.updateSuperBlock(sx, sy, dest.w, dest.h);
+    }
+  }
+}
@@ -7,14 +7,19 @@
 
 // C++ standard library
 #include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <filesystem>
 #include <functional>
 #include <future>
 #include <limits>
+#include <new>
 #include <optional>
+#include <span>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -27,16 +32,23 @@
 #include <SDL_image.h>
 
 // utility
+#include "Arena.hpp"
+#include "BackgroundWorker.hpp"
+#include "Fnv1a.hpp"
 #include "glmprint.hpp"
 #include "NoCopyNoMove.hpp"
+#include "Profiler.hpp"
 #include "Stopwatch.hpp"
 #include "toString.hpp"
+#include "WorkerPool.hpp"
 
 // this project
 #include "copySubImageWithDepth.hpp"
 #include "CpuFrameBuffer.hpp"
 #include "CpuImageWithDepth.hpp"
+#include "CpuSparseImageWithDepth.hpp"
 #include "directions.hpp"
+#include "drawing/BinnedDrawList.hpp"
 #include "drawing/blending/MixArgb.hpp"
 #include "drawing/drawDepthVolume.hpp"
 #include "drawing/drawWithDepth.hpp"
@@ -53,6 +65,8 @@
 #include "raycasting/shapes/makeSphere.hpp"
 #include "raycasting/transform/translate.hpp"
 #include "raycasting/volumes/makeSphere.hpp"
+#include "SpriteAtlas.hpp"
+#include "SpriteCache.hpp"
 
 namespace
 {
@@ -65,6 +79,15 @@ namespace
   {
     constexpr const float scale = 1.f;
     constexpr const char *scaleQuality = "nearest"; // see SDL_HINT_RENDER_SCALE_QUALITY in SDL_hints.h for other options
+    constexpr const unsigned threads = 0; // 0: one per hardware thread; 1: render only on the main thread
+    constexpr const bool lockTexture = true; // draw straight into the streaming texture instead of copying into it
+    constexpr const bool pipelined = true; // render the next frame on another thread while presenting the last one
+    constexpr const bool scrollStaticLayer = true; // when panning, reuse the terrain drawn for the last frame
+  }
+
+  namespace defaults::profiling
+  {
+    constexpr const int framesPerReport = 600; // print zone percentiles this often when built with PROFILER
   }
 
   namespace defaults::window
@@ -78,6 +101,10 @@ namespace
   {
     const std::filesystem::path assets = "assets";
     const std::filesystem::path images = assets / "images";
+    const std::filesystem::path cache = "cache"; // baked sprites; safe to delete
+    const std::filesystem::path tileSprites = cache / "tile sprites.bin";
+    const std::filesystem::path volumeSprites = cache / "volume sprites.bin";
+    const std::filesystem::path profileTrace = "profile.json"; // written on exit when built with PROFILER
   }
 
   //======================================================================================================================
@@ -213,51 +240,210 @@ namespace
     FrameBuffers(SdlRenderer &&, int) = delete;
 
     // bigger scale -> fewer pixels and they are bigger
-    FrameBuffers(const SdlRenderer &renderer, float scale, bool flipVertical = true)
+    // With lockTexture the color of the CPU frame buffer is the locked streaming texture itself, so presenting copies
+    // nothing, and a vertical flip is done by drawing rows bottom-up rather than when presenting.
+    // Locked texture memory starts undefined, which is fine since the frame buffer is cleared before anything reads it,
+    // but it can be slow to read on some renderer backends.
+    // With pipelined, renderWith renders on another thread and returns right away, and present shows the previous
+    // frame while that one renders, then waits for it: a frame takes as long as the slower of rendering and presenting
+    // (including waiting for vsync) instead of both, at the cost of one frame of latency. Frames alternate between two
+    // buffers and present waits for the frame in flight, so there is never more than one frame waiting to be shown.
+    // Either way SDL is only called from the thread which calls renderWith and present.
+    FrameBuffers(const SdlRenderer &renderer, float scale, bool flipVertical = true, bool lockTexture = true, bool pipelined = false)
       : renderer{renderer}
       , scale{scale}
       , flip{flipVertical ? SDL_FLIP_VERTICAL : SDL_FLIP_NONE}
+      , lockTexture{lockTexture}
+      , pipelined{pipelined}
     {
       if (scale <= 0.f)
         throw error("FrameBuffers constructor failed: invalid scale parameter (", scale, ") but must be > 0");
     }
 
+    // When pipelined, cpuRenderer is copied and called on another thread, so whatever it refers to must stay valid
+    // and untouched by this thread until present returns; the copy lives in a per-frame arena, so it must be trivially
+    // destructible (like a lambda capturing references and plain values).
     void renderWith(Function<void(const ViewOfCpuFrameBuffer &)> auto &&cpuRenderer)
     {
+      renderThread.wait(); // renderWith without present: that frame is replaced by this one
+
       allocateBuffersIfNecessary();
-      cpuFrameBuffer->useWith(cpuRenderer);
+
+      Slot &slot = slots[back];
+
+      if (lockTexture)
+        lock(slot); // stays locked until presented
+
+      auto render = [this, &slot, cpuRenderer]
+      {
+        auto renderAndFinishClear = [&](const ViewOfCpuFrameBuffer &frameBuffer)
+        {
+          cpuRenderer(frameBuffer);
+
+          PROFILE_ZONE("finish clear");
+          frameBuffer.finishClear(); // blocks which nothing was drawn to
+        };
+
+        if (slot.lockedImage)
+          slot.cpuFrameBuffer->useWith(slot.lockedImage, flip == SDL_FLIP_VERTICAL, renderAndFinishClear);
+        else
+          slot.cpuFrameBuffer->useWith(renderAndFinishClear);
+      };
+
+      if (pipelined)
+      {
+        // the last frame's job is done, so its copy can go
+        frameArena.reset();
+        auto *job = new (frameArena.allocate<decltype(render)>(1)) decltype(render){render};
+        renderThread.start(*job);
+      }
+      else
+      {
+        render();
+        slot.rendered = true;
+      }
     }
 
+    // Presents the last frame rendered; when pipelined, that is the frame before the one renderWith just started.
     void present()
     {
-      cpuFrameBuffer->useWith(
-        [&](const ViewOfCpuFrameBuffer &imageWithDepth)
-        {
-          int imagePitch = imageWithDepth.w * (int)sizeof(imageWithDepth.image[0]);
+      PROFILE_ZONE("present");
+
+      if (!pipelined)
+      {
+        present(slots[0]);
+        return;
+      }
 
-          if (SDL_UpdateTexture(renderBufferTexture->texture, nullptr, imageWithDepth.image, imagePitch))
-            throw error("SDL_UpdateTexture failed: ", SDL_GetError());
+      present(slots[back ^ 1]);
 
-          if (SDL_RenderCopyEx(renderer.renderer, renderBufferTexture->texture, nullptr, nullptr, 0.0, nullptr, flip))
-            throw error("SDL_RenderCopyEx failed: ", SDL_GetError());
-        });
-      SDL_RenderPresent(renderer.renderer);
+      if (!renderThread.isPending())
+        return;
+
+      {
+        PROFILE_ZONE("wait for render");
+        renderThread.wait(); // rethrows anything the renderer threw
+      }
+
+      slots[back].rendered = true;
+      back ^= 1;
     }
 
   private:
+    // one frame's worth of buffers
+    struct Slot
+    {
+      std::optional<RenderBufferTexture> renderBufferTexture;
+      std::optional<CpuFrameBuffer> cpuFrameBuffer;
+      uint32_t *lockedImage{}; // pixels of renderBufferTexture while it is locked
+      bool rendered{false}; // holds a frame which hasn't been presented yet
+    };
+
     const SdlRenderer &renderer;
     const float scale;
     const SDL_RendererFlip flip;
+    const bool lockTexture;
+    const bool pipelined;
 
     int scaledWidth{-1}, scaledHeight{-1};
     int lastRendererWidth{-1}, lastRendererHeight{-1};
-    std::optional<RenderBufferTexture> renderBufferTexture;
-    std::optional<CpuFrameBuffer> cpuFrameBuffer;
+    Arena bufferArena{Arena::hugePageBytes, true}; // the CPU frame buffers, all replaced at once when the size changes
+    std::array<Slot, 2> slots; // only the first unless pipelined
+    int back{0}; // slot which renderWith renders to
+    Arena frameArena{4096}; // the job rendering the current frame, when pipelined
+    BackgroundWorker renderThread; // when pipelined; last, so it waits for a job before what the job uses is destroyed
+
+    // Locks the whole texture for writing; if pitch is not nullptr then it receives the distance between rows in pixels.
+    static uint32_t *
+    lock(const RenderBufferTexture &texture, int *pitch)
+    {
+      void *pixels;
+      int pitchBytes;
+
+      if (SDL_LockTexture(texture.texture, nullptr, &pixels, &pitchBytes))
+        throw error("SDL_LockTexture failed: ", SDL_GetError());
+
+      if (pitch)
+        *pitch = pitchBytes / (int)sizeof(uint32_t);
+
+      return (uint32_t *)pixels;
+    }
+
+    void lock(Slot &slot)
+    {
+      if (slot.lockedImage)
+        return;
+
+      int pitch;
+      slot.lockedImage = lock(*slot.renderBufferTexture, &pitch);
+
+      if (pitch != slot.cpuFrameBuffer->getPitch())
+      {
+        SDL_UnlockTexture(slot.renderBufferTexture->texture);
+        slot.lockedImage = nullptr;
+        throw error("SDL_LockTexture returned pitch ", pitch, " but the frame buffer was made for pitch ", slot.cpuFrameBuffer->getPitch());
+      }
+    }
+
+    void present(Slot &slot)
+    {
+      if (!slot.rendered)
+        return;
+
+      if (lockTexture)
+      {
+        SDL_UnlockTexture(slot.renderBufferTexture->texture);
+        slot.lockedImage = nullptr;
+
+        if (SDL_RenderCopy(renderer.renderer, slot.renderBufferTexture->texture, nullptr, nullptr))
+          throw error("SDL_RenderCopy failed: ", SDL_GetError());
+      }
+      else
+        slot.cpuFrameBuffer->useWith(
+          [&](const ViewOfCpuFrameBuffer &imageWithDepth)
+          {
+            int imagePitch = imageWithDepth.pitch * (int)sizeof(imageWithDepth.image[0]);
+
+            {
+              PROFILE_ZONE("SDL_UpdateTexture");
+              if (SDL_UpdateTexture(slot.renderBufferTexture->texture, nullptr, imageWithDepth.image, imagePitch))
+                throw error("SDL_UpdateTexture failed: ", SDL_GetError());
+            }
+
+            if (SDL_RenderCopyEx(renderer.renderer, slot.renderBufferTexture->texture, nullptr, nullptr, 0.0, nullptr, flip))
+              throw error("SDL_RenderCopyEx failed: ", SDL_GetError());
+          });
+
+      slot.rendered = false;
+
+      SDL_RenderPresent(renderer.renderer);
+    }
 
     void allocateBuffers()
     {
-      renderBufferTexture.emplace(renderer, scaledWidth, scaledHeight);
-      cpuFrameBuffer.emplace(scaledWidth, scaledHeight);
+      // nothing may be left in the arena when it is reset
+      for (Slot &slot: slots)
+        slot.cpuFrameBuffer.reset();
+
+      bufferArena.reset();
+
+      for (Slot &slot: std::span{slots}.first(pipelined ? 2 : 1))
+      {
+        slot.lockedImage = nullptr; // destroying the texture also unlocks it
+        slot.rendered = false;
+        slot.renderBufferTexture.emplace(renderer, scaledWidth, scaledHeight);
+
+        // when drawing into the texture, the rows of the frame buffer must be as far apart as the texture's
+        int pitch = 0;
+
+        if (lockTexture)
+        {
+          lock(*slot.renderBufferTexture, &pitch);
+          SDL_UnlockTexture(slot.renderBufferTexture->texture);
+        }
+
+        slot.cpuFrameBuffer.emplace(scaledWidth, scaledHeight, true, pitch, &bufferArena); // lazy clear: blocks are filled when first drawn to, or before present
+      }
     }
 
     void allocateBuffersIfNecessary()
@@ -293,6 +479,25 @@ namespace testing
     std::optional<CpuImageWithDepth> quadImage{}, coneImage{}, unionImage{}, texturedSphereImage{};
     glm::ivec3 quadAnchor{}, coneAnchor{}, unionAnchor{}, texturedSphereAnchor{};
 
+    // the tile images: baked into the images above then packed into the atlas, or the atlas mapped from the sprite cache
+    std::optional<SpriteCache> spriteCache{};
+    std::optional<SpriteAtlas> atlas{};
+    ViewOfCpuImageWithDepth quadView{}, coneView{}, texturedSphereView{};
+
+    // mostly empty tiles are drawn from span-encoded copies
+    std::optional<CpuSparseImageWithDepth> coneSparseImage{}, texturedSphereSparseImage{};
+
+    drawing::BinnedDrawList drawList;
+
+    static constexpr int radiusInTiles = 30;
+
+    // the terrain as seen from staticLayerCenter, for frame buffers of staticLayerSize
+    std::optional<CpuFrameBuffer> staticLayer{};
+    glm::ivec2 staticLayerSize{};
+    glm::ivec3 staticLayerCenter{};
+    bool staticLayerDepthExact{false}; // no quad depth overflowed, so the layer can be scrolled
+    const bool scrollStaticLayer;
+
     static glm::ivec2 calculateTileScreenSize(glm::mat3 worldToScreen)
     {
       glm::vec3 tileMaxWorld{tileIntervalWorld * 0.5f + tileMarginWorld};
@@ -313,14 +518,138 @@ namespace testing
       return 2 * glm::ivec2(glm::ceil(glm::vec2(screenMax)));
     }
 
+    // Calls f(xyz, screen position of the tile's center relative to the screen's center) for each tile.
+    void forEachTile(glm::ivec3 screenCoordsOfWorldCenter, auto &&f) const
+    {
+      // TODO: figure out how to enumerate all visible tiles and no non-visible tiles,
+      // given that the camera angle hasn't been set in stone yet so the formula should be generalized for now
+      // Probably could use flood-fill where a tile is a candidate if it overlaps the screen.
+
+      for (glm::ivec3 xyz{0.f, -radiusInTiles, 0.f}; xyz.y < radiusInTiles; ++xyz.y)
+        for (xyz.x = -radiusInTiles; xyz.x < radiusInTiles; ++xyz.x)
+        {
+          glm::ivec3 thisTileOffset{xyz * tileIntervalScreen};
+          f(xyz, thisTileOffset + screenCoordsOfWorldCenter);
+        }
+    }
+
+    // Brings the static layer up to date for frame buffers of w x h pixels centered on screenCoordsOfWorldCenter.
+    void renderStaticLayer(int w, int h, glm::ivec3 screenCoordsOfWorldCenter, WorkerPool *pool)
+    {
+      PROFILE_ZONE("static layer render");
+
+      const bool resized = !staticLayer || staticLayerSize != glm::ivec2{w, h};
+
+      if (resized)
+      {
+        staticLayer.emplace(w, h);
+        staticLayerSize = {w, h};
+      }
+
+      // Every quad's depth moves by the camera's z offset, so scrolling the layer gives the same pixels as redrawing it,
+      // as long as no depth overflows (or saturates) either before or after.
+      int minz = std::numeric_limits<int>::max(), maxz = std::numeric_limits<int>::min();
+      forEachTile(
+        screenCoordsOfWorldCenter,
+        [&](glm::ivec3, glm::ivec3 thisTilePosition)
+        {
+          (minz = std::min(minz, thisTilePosition.z - quadAnchor.z), maxz = std::max(maxz, thisTilePosition.z - quadAnchor.z));
+        });
+      const bool depthExact = minz >= INT16_MIN && maxz + 254 < INT16_MAX; // 254: deepest opaque sprite depth
+
+      const glm::ivec3 offset = screenCoordsOfWorldCenter - staticLayerCenter;
+      const bool scroll = scrollStaticLayer && !resized && staticLayerDepthExact && depthExact && std::abs(offset.x) < w && std::abs(offset.y) < h;
+
+      (staticLayerCenter = screenCoordsOfWorldCenter, staticLayerDepthExact = depthExact);
+
+      staticLayer->useWith(
+        [&](const ViewOfCpuFrameBuffer &layer)
+        {
+          if (scroll)
+          {
+            layer.scroll(offset.x, offset.y, (int16_t)offset.z, 0xff000000, 0x7fff);
+
+            // columns uncovered on the left or right, then rows uncovered at the top or bottom
+            if (offset.x)
+              drawStaticRegion(layer, offset.x > 0 ? 0 : w + offset.x, 0, std::abs(offset.x), h, pool);
+            if (offset.y)
+              drawStaticRegion(layer, 0, offset.y > 0 ? 0 : h + offset.y, w, std::abs(offset.y), pool);
+
+            // scrolling reset the depth pyramid, and it is copied to every frame for culling the moving sprites
+            layer.hiz.update(layer.depth, layer.pitch, w, h);
+          }
+          else
+          {
+            layer.clear(0xff000000, 0x7fff);
+            drawStaticRegion(layer, 0, 0, w, h, pool);
+          }
+        });
+    }
+
+    // Draws the quads within a rectangle of the static layer, as seen from staticLayerCenter.
+    void drawStaticRegion(const ViewOfCpuFrameBuffer &layer, int x, int y, int regionw, int regionh, WorkerPool *pool)
+    {
+      drawList.clear();
+
+      forEachTile(
+        staticLayerCenter,
+        [&](glm::ivec3, glm::ivec3 thisTilePosition)
+        {
+          glm::ivec3 screenPosition = thisTilePosition - quadAnchor;
+          drawList.add(layer.w / 2 + screenPosition.x - x, layer.h / 2 + screenPosition.y - y, quadView, (int16_t)screenPosition.z);
+        });
+
+      // in the same order as when the whole layer is drawn, so that equal depths resolve the same way
+      drawList.sortFrontToBack();
+      drawList.draw(layer.subView(x, y, regionw, regionh), pool);
+    }
+
+    // true if the atlas of tile images (and their anchors) was loaded from an up-to-date sprite cache, which it is then
+    // drawn from as it is mapped
+    bool loadTileAtlas(const std::filesystem::path &spriteCachePath, uint64_t key)
+    {
+      spriteCache = SpriteCache::load(spriteCachePath, key);
+
+      if (spriteCache)
+      {
+        auto tileAtlas = spriteCache->image("tile atlas");
+        auto quad = spriteCache->image("quad", &quadAnchor);
+        auto cone = spriteCache->image("cone", &coneAnchor);
+        auto texturedSphere = spriteCache->image("textured sphere", &texturedSphereAnchor);
+
+        if (tileAtlas && quad && cone && texturedSphere)
+        {
+          try
+          {
+            const ViewOfCpuImageWithDepth images[] = {*quad, *cone, *texturedSphere};
+            const glm::ivec3 anchors[] = {quadAnchor, coneAnchor, texturedSphereAnchor};
+            atlas.emplace(*tileAtlas, images, anchors);
+            return true;
+          }
+          catch (const std::runtime_error &)
+          {
+            // the tile images aren't within the atlas, so bake them again
+          }
+        }
+
+        spriteCache.reset();
+      }
+
+      return false;
+    }
+
   public:
     TileRenderer(
       const raycasting::cameras::Orthogonal &camera,
       glm::mat3 screenToWorld,
-      glm::mat3 worldToScreen)
+      glm::mat3 worldToScreen,
+      WorkerPool *pool, // used while baking tile images; may be nullptr
+      const std::filesystem::path &spriteCachePath, // baked tile images are loaded from here if up to date, otherwise saved here
+      bool scrollStaticLayer = true) // when the camera moves by whole pixels, scroll the terrain and only draw what is uncovered
       : screenToWorld{screenToWorld}
       , worldToScreen{worldToScreen}
       , tileIntervalScreen{glm::mat3{(float)tileIntervalWorld} * worldToScreen}
+      , scrollStaticLayer{scrollStaticLayer}
     {
       using namespace directions;
       using namespace gradient;
@@ -330,138 +659,195 @@ namespace testing
       using namespace raycasting::shapes;
       using namespace raycasting::transform;
 
-      // temporary image for raycasting
       glm::ivec2 tileImageSize{calculateTileScreenSize(worldToScreen)};
-      CpuImageWithDepth renderTemp{tileImageSize.x, tileImageSize.y};
-
-      // objects to render
-      //const auto sphere = makeSphere(
-      //  glm::rgbColor(glm::vec3{98.f, 0.8f, 0.76f}),
-      //  glm::vec3{0.f},
-      //  tileIntervalWorld * 0.38f);
-      const auto cone =
-        translate(
-          makeCone(
-            glm::rgbColor(glm::vec3{98.f, 0.8f, 0.76f}),
-            -tileIntervalWorld * 0.38f,
-            tileIntervalWorld * 0.38f),
-          glm::vec3{0.f, 0.f, tileIntervalWorld * 0.5});
-
-      auto dirtAndGrass =
-        makeNoisyDiffuse(
-          makeGradient(
-            std::vector<std::pair<float, glm::vec3>>
-              {
-                {0.f, glm::rgbColor(glm::vec3{43.f, 1.f, 0.3f})},
-                {0.7f, glm::rgbColor(glm::vec3{43.f, 0.9f, 0.4f})},
-                {0.8f, glm::rgbColor(glm::vec3{106.f, 1.f, 0.48f})}
-              }));
 
-      const float halfIntervalPlusMargin = tileIntervalWorld * 0.5f + tileMarginWorld;
-      const auto quad = makeQuad(
-        [=](const glm::vec3 &x) {return dirtAndGrass(x * 0.35f);},
-        //glm::rgbColor(glm::vec3{38.f, 0.68f, 0.73f}),
-        glm::vec3{0.f},
-        halfIntervalPlusMargin * forward,
-        halfIntervalPlusMargin * right);
-
-      //const auto csgUnion = makeUnion({sphere, quad});
+      // everything the tile images are baked from, so that it can all go into the sprite cache key
+      const glm::vec3 coneDiffuse = glm::rgbColor(glm::vec3{98.f, 0.8f, 0.76f});
+      const float coneHeight = -tileIntervalWorld * 0.38f, coneRadiusAtHeight = tileIntervalWorld * 0.38f;
+      const glm::vec3 coneOffset{0.f, 0.f, tileIntervalWorld * 0.5};
 
-      glm::vec3 minLight{0.2f};
-      std::vector<DirectionalLight> directionalLights{DirectionalLight{glm::normalize(forward + down), glm::vec3{1.f, 1.f, 1.f}}};
+      const std::vector<std::pair<float, glm::vec3>> dirtAndGrassGradient
+        {
+          {0.f, glm::rgbColor(glm::vec3{43.f, 1.f, 0.3f})},
+          {0.7f, glm::rgbColor(glm::vec3{43.f, 0.9f, 0.4f})},
+          {0.8f, glm::rgbColor(glm::vec3{106.f, 1.f, 0.48f})}
+        };
+      const float dirtAndGrassScale = 0.35f;
+      const float halfIntervalPlusMargin = tileIntervalWorld * 0.5f + tileMarginWorld;
 
-      // render and trim tile images
+      const std::vector<std::pair<float, glm::vec3>> texturedSphereGradient
+        {
+          {0.f, {1.f, 0.2f, 0.f}},
+          {1.f, {0.f, 0.5f, 1.f}}
+        };
+      const float texturedSphereScale = 0.1f, texturedSphereRadius = tileIntervalWorld * 0.38f;
+
+      const glm::vec3 minLight{0.2f};
+      const glm::vec3 lightDirection = glm::normalize(forward + down), lightIntensity{1.f, 1.f, 1.f};
+
+      // increment when changing how the tiles are baked in a way the values above don't capture
+      constexpr uint32_t bakeVersion = 3;
+
+      Fnv1a key;
+      key.add(bakeVersion).add(camera.normal).add(camera.xstep).add(camera.ystep).add(worldToScreen).add(tileImageSize);
+      key.add(coneDiffuse).add(coneHeight).add(coneRadiusAtHeight).add(coneOffset);
+      for (const auto &[t, color]: dirtAndGrassGradient)
+        key.add(t).add(color);
+      key.add(dirtAndGrassScale).add(halfIntervalPlusMargin);
+      for (const auto &[t, color]: texturedSphereGradient)
+        key.add(t).add(color);
+      key.add(texturedSphereScale).add(texturedSphereRadius);
+      key.add(minLight).add(lightDirection).add(lightIntensity);
+
+      // baking's temporary images, freed all at once when the tile images have been packed into the atlas
+      std::optional<Arena> bakeArena{};
+
+      if (!loadTileAtlas(spriteCachePath, key.value))
       {
-        int minx, miny, width, height;
-
-        ViewOfCpuImageWithDepth renderTempView = renderTemp.getUnsafeView();
-
-        // cone
+        // room for each tile image, which is never bigger than tileImageSize
+        bakeArena.emplace(4 * sizeof(uint32_t) * size_t(tileImageSize.x) * size_t(tileImageSize.y));
+
+        // objects to render
+        //const auto sphere = makeSphere(
+        //  glm::rgbColor(glm::vec3{98.f, 0.8f, 0.76f}),
+        //  glm::vec3{0.f},
+        //  tileIntervalWorld * 0.38f);
+        const auto cone =
+          translate8(
+            makeCone8(
+              coneDiffuse,
+              coneHeight,
+              coneRadiusAtHeight),
+            coneOffset);
+        const Bounds coneBounds = translate(raycasting::shapes::coneBounds(coneHeight, coneRadiusAtHeight), coneOffset);
+
+        const auto quad = makeQuad8(
+          makeNoisyDiffuse8(GradientTable{dirtAndGrassGradient}, dirtAndGrassScale),
+          //glm::rgbColor(glm::vec3{38.f, 0.68f, 0.73f}),
+          glm::vec3{0.f},
+          halfIntervalPlusMargin * forward,
+          halfIntervalPlusMargin * right);
+        const Bounds quadBounds = raycasting::shapes::quadBounds(
+          glm::vec3{0.f},
+          halfIntervalPlusMargin * forward,
+          halfIntervalPlusMargin * right);
+
+        //const auto csgUnion = makeUnion({sphere, quad});
+
+        std::vector<DirectionalLight> directionalLights{DirectionalLight{lightDirection, lightIntensity}};
+
+        // Renders what would cover a tileImageSize image centered on the world origin, but only the pixels which
+        // bounds projects onto, straight into image, sized to fit them, so there is nothing to trim afterwards.
+        auto renderTileImage = [&](
+          std::optional<CpuImageWithDepth> &image, glm::ivec3 &anchor, const PacketIntersector &intersect, const Bounds &bounds)
         {
-          camera.render(
-            renderTempView,
-            cone,
+          const cameras::Orthogonal::PixelRect rect = camera.project(bounds, tileImageSize);
+
+          image.emplace(rect.w, rect.h, &*bakeArena);
+          camera.render8Window(
+            image->getUnsafeView(),
+            {(float)tileImageSize.x * 0.5f - (float)rect.x, (float)tileImageSize.y * 0.5f - (float)rect.y},
+            intersect,
             minLight,
             &directionalLights[0],
-            (int)directionalLights.size());
-          measureImageBounds(renderTempView, &minx, &miny, &width, &height);
-          coneAnchor.x = renderTempView.w / 2 - minx;
-          coneAnchor.y = renderTempView.h / 2 - miny;
-          coneImage.emplace(width, height);
-          copySubImageWithDepth(coneImage->getUnsafeView(), 0, 0, renderTempView, minx, miny, width, height);
+            (int)directionalLights.size(),
+            0xff000000,
+            pool);
+          image->measureMinDepth();
+
+          anchor.x = tileImageSize.x / 2 - rect.x;
+          anchor.y = tileImageSize.y / 2 - rect.y;
+        };
+
+        // render tile images
+        {
+          renderTileImage(coneImage, coneAnchor, cone, coneBounds);
+          renderTileImage(quadImage, quadAnchor, quad, quadBounds);
+
+          // union, which has no bounds to project, so it would be rendered whole then trimmed
+          //{
+          //  CpuImageWithDepth renderTemp{tileImageSize.x, tileImageSize.y, &*bakeArena};
+          //  ViewOfCpuImageWithDepth renderTempView = renderTemp.getUnsafeView();
+          //  int minx, miny, width, height;
+          //  camera.render(
+          //    renderTempView,
+          //    csgUnion,
+          //    minLight,
+          //    &directionalLights[0],
+          //    (int)directionalLights.size());
+          //  measureImageBounds(renderTempView, &minx, &miny, &width, &height);
+          //  unionAnchor.x = renderTempView.w / 2 - minx;
+          //  unionAnchor.y = renderTempView.h / 2 - miny;
+          //  unionImage.emplace(width, height);
+          //  copySubImageWithDepth(unionImage->getUnsafeView(), 0, 0, renderTempView, minx, miny, width, height);
+          //}
+
+          // textured sphere
+          {
+            const auto texturedSphere = makeSphere8(
+              makeNoisyDiffuse8(GradientTable{texturedSphereGradient}, texturedSphereScale),
+              glm::vec3{0.f},
+              texturedSphereRadius);
+
+            renderTileImage(
+              texturedSphereImage,
+              texturedSphereAnchor,
+              texturedSphere,
+              sphereBounds(glm::vec3{0.f}, texturedSphereRadius));
+          }
         }
 
-        // quad
+        // draw from one allocation, and let go of the baked images
         {
-          camera.render(
-            renderTempView,
-            quad,
-            minLight,
-            &directionalLights[0],
-            (int)directionalLights.size());
+          const ViewOfCpuImageWithDepth images[] = {quadImage->getUnsafeView(), coneImage->getUnsafeView(), texturedSphereImage->getUnsafeView()};
+          const glm::ivec3 anchors[] = {quadAnchor, coneAnchor, texturedSphereAnchor};
+          atlas.emplace(images, anchors);
 
-          measureImageBounds(renderTempView, &minx, &miny, &width, &height);
-          quadAnchor.x = renderTempView.w / 2 - minx;
-          quadAnchor.y = renderTempView.h / 2 - miny;
-          quadImage.emplace(width, height);
-          copySubImageWithDepth(quadImage->getUnsafeView(), 0, 0, renderTempView, minx, miny, width, height);
+          (quadImage.reset(), coneImage.reset(), texturedSphereImage.reset());
         }
 
-        // union
-        //{
-        //  camera.render(
-        //    renderTempView,
-        //    csgUnion,
-        //    minLight,
-        //    &directionalLights[0],
-        //    (int)directionalLights.size());
-        //  measureImageBounds(renderTempView, &minx, &miny, &width, &height);
-        //  unionAnchor.x = renderTempView.w / 2 - minx;
-        //  unionAnchor.y = renderTempView.h / 2 - miny;
-        //  unionImage.emplace(width, height);
-        //  copySubImageWithDepth(unionImage->getUnsafeView(), 0, 0, renderTempView, minx, miny, width, height);
-        //}
-
-        // textured sphere
+        // the atlas as it is, with where each tile image is in it, so that it is mapped and drawn from next time
+        try
         {
-          auto noisyDiffuse =
-            makeNoisyDiffuse(
-              makeGradient(
-                std::vector<std::pair<float, glm::vec3>>
-                  {
-                    {0.f, {1.f, 0.2f, 0.f}},
-                    {1.f, {0.f, 0.5f, 1.f}}
-                  }));
-
-          const auto texturedSphere = makeSphere(
-            [=](const glm::vec3 x) {return noisyDiffuse(x * 0.1f);},
-            glm::vec3{0.f},
-            tileIntervalWorld * 0.38f);
-
-          camera.render(
-            renderTempView,
-            texturedSphere,
-            minLight,
-            &directionalLights[0],
-            (int)directionalLights.size());
-          measureImageBounds(renderTempView, &minx, &miny, &width, &height);
-          texturedSphereAnchor.x = renderTempView.w / 2 - minx;
-          texturedSphereAnchor.y = renderTempView.h / 2 - miny;
-          texturedSphereImage.emplace(width, height);
-          copySubImageWithDepth(texturedSphereImage->getUnsafeView(), 0, 0, renderTempView, minx, miny, width, height);
+          SpriteCacheWriter writer;
+          writer.add("tile atlas", atlas->getUnsafeView());
+
+          auto addSprite = [&](std::string_view name, const AtlasSprite &sprite)
+          {
+            writer.addSubImage(name, "tile atlas", sprite.x, sprite.y, sprite.image, sprite.anchor);
+          };
+
+          addSprite("quad", atlas->sprite(0));
+          addSprite("cone", atlas->sprite(1));
+          addSprite("textured sphere", atlas->sprite(2));
+          writer.write(spriteCachePath, key.value);
+        }
+        catch (const std::runtime_error &e)
+        {
+          // not fatal: the tiles will be baked again next time
+          std::cerr << "could not save sprite cache: " << e.what() << std::endl;
         }
       }
+
+      (quadView = atlas->sprite(0).image, coneView = atlas->sprite(1).image, texturedSphereView = atlas->sprite(2).image);
+
+      coneSparseImage.emplace(coneView);
+      texturedSphereSparseImage.emplace(texturedSphereView);
     }
 
-    void render(const ViewOfCpuFrameBuffer &frameBuffer, glm::vec3 screenCenterInWorld)
+    // Fills the whole frame buffer, so it needn't be cleared first.
+    // The terrain doesn't move relative to the world, so it is drawn into a static layer which is only redrawn when the
+    // frame buffer changes size, and only scrolled when the camera moves (drawing just the strips uncovered); each frame
+    // copies that layer into the frame buffer and draws the moving sprites over it, one bin at a time.
+    // pool may be nullptr to render on the calling thread
+    void render(const ViewOfCpuFrameBuffer &frameBuffer, glm::vec3 screenCenterInWorld, WorkerPool *pool)
     {
       using namespace drawing;
 
       glm::ivec3 screenCoordsOfWorldCenter{-screenCenterInWorld * worldToScreen};
 
-      // TODO: figure out how to enumerate all visible tiles and no non-visible tiles,
-      // given that the camera angle hasn't been set in stone yet so the formula should be generalized for now
-      // Probably could use flood-fill where a tile is a candidate if it overlaps the screen.
+      if (!staticLayer || staticLayerSize != glm::ivec2{frameBuffer.w, frameBuffer.h} || staticLayerCenter != screenCoordsOfWorldCenter)
+        renderStaticLayer(frameBuffer.w, frameBuffer.h, screenCoordsOfWorldCenter, pool);
 
       static auto startTime = clock::now();
       const double waveFrequency = 1.0 / 3.0;
@@ -470,60 +856,55 @@ namespace testing
       const auto phase = (double)(elapsedMicros % (decltype(elapsedMicros))(microsPerCycle)) / microsPerCycle;
       const float waveAmplitudeWorldUnits = 50.f;
 
-      int radiusInTiles = 30;
+      drawList.clear();
 
-      for (glm::ivec3 xyz{0.f, -radiusInTiles, 0.f}; xyz.y < radiusInTiles; ++xyz.y)
-        for (xyz.x = -radiusInTiles; xyz.x < radiusInTiles; ++xyz.x)
+      forEachTile(
+        screenCoordsOfWorldCenter,
+        [&](glm::ivec3 xyz, glm::ivec3 thisTilePosition)
         {
-          glm::ivec3 thisTileOffset{xyz * tileIntervalScreen};
-          glm::ivec3 thisTilePosition{thisTileOffset + screenCoordsOfWorldCenter};
-
           float wavePhaseOffset = glm::length(glm::vec2(xyz.x, xyz.y) / (float)radiusInTiles);
 
           glm::vec3 waveOffset = glm::vec3{0.0f, 0.f, 1.f} * waveAmplitudeWorldUnits * (float)glm::sin((-phase + wavePhaseOffset) * glm::pi<double>() * 2.0);
           glm::ivec3 waveOffsetScreen{waveOffset * worldToScreen};
 
-          {
-            glm::ivec3 screenPosition = thisTilePosition - quadAnchor;
-            drawWithDepth(
-              frameBuffer,
-              frameBuffer.w / 2 + screenPosition.x,
-              frameBuffer.h / 2 + screenPosition.y,
-              quadImage->getUnsafeView(),
-              (int16_t)screenPosition.z);
-          }
-
           if (xyz.x & 2)
           {
             glm::ivec3 screenPosition = thisTilePosition - coneAnchor + waveOffsetScreen;
-            drawWithDepth(
-              frameBuffer,
+            drawList.add(
               frameBuffer.w / 2 + screenPosition.x,
               frameBuffer.h / 2 + screenPosition.y,
-              coneImage->getUnsafeView(),
+              coneSparseImage->getUnsafeView(),
               (int16_t)screenPosition.z);
           }
           else
           {
             {
               glm::ivec3 screenPosition = thisTilePosition - texturedSphereAnchor + waveOffsetScreen;
-              drawWithDepth(
-                frameBuffer,
+              drawList.add(
                 frameBuffer.w / 2 + screenPosition.x,
                 frameBuffer.h / 2 + screenPosition.y,
-                texturedSphereImage->getUnsafeView(),
+                texturedSphereSparseImage->getUnsafeView(),
                 (int16_t)screenPosition.z);
             }
             //glm::ivec3 screenPosition = thisTilePosition - unionAnchor;
-            //drawWithDepth(
-            //  frameBuffer,
+            //drawList.add(
             //  frameBuffer.w / 2 + screenPosition.x,
             //  frameBuffer.h / 2 + screenPosition.y,
             //  unionImage->getUnsafeView(),
             //  (int16_t)screenPosition.z);
           }
-        }
+        });
+
+      // near tiles first so that hidden parts of far tiles can be culled
+      drawList.sortFrontToBack();
+
+      // the static layer's depth pyramid comes along with it, so moving sprites behind the terrain are culled too
+      staticLayer->useWith([&](const ViewOfCpuFrameBuffer &layer) {drawList.draw(frameBuffer, pool, &layer);});
     }
+
+    // overdraw statistics of the moving sprites of the last render
+    [[nodiscard]] const drawing::DrawStats &
+    drawStats() const {return drawList.stats();}
   };
 }
 
@@ -550,7 +931,6 @@ int main(int argc, char *argv[])
 
     SdlWindow window{sdl, defaults::window::width, defaults::window::height};
     SdlRenderer renderer{window};
-    FrameBuffers frameBuffers{renderer, defaults::render::scale};
 
     //----------------------------------------------------------------------------------------------------------------------
     // TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING
@@ -602,20 +982,59 @@ int main(int argc, char *argv[])
     glm::mat3 screenToWorld = glm::inverse(worldToScreen);
 
     // TESTING volume rendering
-    CpuDepthVolume depthVolume{260, 260};
+    std::optional<CpuDepthVolume> depthVolume{};
+    std::optional<SpriteCache> volumeCache{};
+    ViewOfCpuDepthVolume volumeView{};
     {
-      raycasting::cameras::OrthogonalVolume volumeCamera{camera.normal, camera.xstep, camera.ystep};
+      const int volumeSize = 260;
+      const float sphereRadius = 127.f;
+
+      // increment when changing how the volume is baked in a way the values above don't capture
+      constexpr uint32_t bakeVersion = 3;
+
+      Fnv1a key;
+      key.add(bakeVersion).add(camera.normal).add(camera.xstep).add(camera.ystep).add(volumeSize).add(sphereRadius);
 
-      auto sphere = raycasting::volumes::makeSphere(glm::vec3{0.f}, 127.f);
+      volumeCache = SpriteCache::load(defaults::paths::volumeSprites, key.value);
 
-      volumeCamera.render(
-        depthVolume.getUnsafeView(),
-        sphere);
+      if (std::optional<ViewOfCpuDepthVolume> cached = volumeCache ? volumeCache->volume("sphere") : std::nullopt)
+        volumeView = *cached;
+      else
+      {
+        raycasting::cameras::OrthogonalVolume volumeCamera{camera.normal, camera.xstep, camera.ystep};
+
+        auto sphere = raycasting::volumes::makeSphere(glm::vec3{0.f}, sphereRadius);
+
+        depthVolume.emplace(volumeSize, volumeSize);
+        volumeView = depthVolume->getUnsafeView();
+
+        volumeCamera.render(
+          volumeView,
+          sphere);
+
+        try
+        {
+          SpriteCacheWriter writer;
+          writer.add("sphere", volumeView);
+          writer.write(defaults::paths::volumeSprites, key.value);
+        }
+        catch (const std::runtime_error &e)
+        {
+          std::cerr << "could not save sprite cache: " << e.what() << std::endl;
+        }
+      }
     };
 
-    testing::TileRenderer tileRenderer{camera, screenToWorld, worldToScreen};
+    WorkerPool workerPool{defaults::render::threads};
+    std::cout << "render threads: " << workerPool.size() << std::endl;
+    std::cout << "drawing kernels: " << drawing::kernels::active().name << std::endl; // DRAWING_KERNELS=scalar etc. to override
+
+    testing::TileRenderer tileRenderer{camera, screenToWorld, worldToScreen, &workerPool, defaults::paths::tileSprites, defaults::render::scrollStaticLayer};
     const MovementVectors movementVectors{screenToWorld};
 
+    // after everything its renderer refers to, so it is destroyed first and waits for a frame still being rendered
+    FrameBuffers frameBuffers{renderer, defaults::render::scale, true, defaults::render::lockTexture, defaults::render::pipelined};
+
     glm::vec3 worldPosition{0.f};
     glm::vec3 movementRequest;
     float movementSpeedPerFrame = 10.f;
@@ -639,33 +1058,42 @@ int main(int argc, char *argv[])
         {SDLK_RIGHT, &keyStates.right}
       };
 
+    [[maybe_unused]] int frame = 0; // only counted when built with PROFILER
+    Stopwatch sw{}; // of the volume render
+
     // render loop
     for (bool quit = false; !quit;)
     {
+      PROFILE_ZONE("frame");
+
       movementRequest = glm::vec3{0.f};
 
       // handle SDL events
-      for (SDL_Event e; 0 != SDL_PollEvent(&e);)
       {
-        switch (e.type)
+        PROFILE_ZONE("events");
+
+        for (SDL_Event e; 0 != SDL_PollEvent(&e);)
         {
-        case SDL_QUIT:
-          quit = true;
-          break;
-          // TODO: keep track of which relevant keys are pressed
-        case SDL_KEYDOWN:
-          if (!e.key.repeat)
+          switch (e.type)
           {
+          case SDL_QUIT:
+            quit = true;
+            break;
+            // TODO: keep track of which relevant keys are pressed
+          case SDL_KEYDOWN:
+            if (!e.key.repeat)
+            {
+              SDL_Keycode keycode = e.key.keysym.sym;
+              if (auto keyToStateIt = keyToState.find(keycode); keyToStateIt != keyToState.end())
+                *keyToStateIt->second += 1;
+            }
+            break;
+          case SDL_KEYUP:
             SDL_Keycode keycode = e.key.keysym.sym;
             if (auto keyToStateIt = keyToState.find(keycode); keyToStateIt != keyToState.end())
-              *keyToStateIt->second += 1;
+              *keyToStateIt->second -= 1;
+            break;
           }
-          break;
-        case SDL_KEYUP:
-          SDL_Keycode keycode = e.key.keysym.sym;
-          if (auto keyToStateIt = keyToState.find(keycode); keyToStateIt != keyToState.end())
-            *keyToStateIt->second -= 1;
-          break;
         }
       }
 
@@ -689,36 +1117,53 @@ int main(int argc, char *argv[])
 
       glm::vec3 screenCenterInWorld = worldPosition;
 
-      Stopwatch sw{};
-
+      // may render on another thread until present() returns, so per-frame state is captured by value
       frameBuffers.renderWith(
-        [&](const ViewOfCpuFrameBuffer &frameBuffer)
+        [&, screenCenterInWorld](const ViewOfCpuFrameBuffer &frameBuffer)
         {
-          frameBuffer.clear(0xff000000, 0x7fff);
-          tileRenderer.render(frameBuffer, screenCenterInWorld);
+          {
+            PROFILE_ZONE("tile render"); // fills the frame buffer
+            tileRenderer.render(frameBuffer, screenCenterInWorld, &workerPool);
+          }
           sw.start();
           {
-            auto volumeView = depthVolume.getUnsafeView();
+            PROFILE_ZONE("volume render");
             drawing::drawDepthVolume(
               frameBuffer,
               frameBuffer.w / 2 - volumeView.w / 2,
               frameBuffer.h / 2 - volumeView.h / 2,
               volumeView,
               0,
-              [](uint32_t destArgb, uint8_t thickness) -> uint32_t
-              {
-                constexpr uint32_t srcArgb = 0xffffffff;
-                return drawing::blending::MixArgb::mix(destArgb, srcArgb, thickness);
-              });
+              drawing::blending::MixArgbConst1{0xffffffff}); // drawn with the drawing kernels' MixArgbConst1 row
           }
           sw.stop();
         });
 
-      SDL_SetWindowTitle(window.window, toString(defaults::window::title, " render millis: ", sw.millis()).c_str());
-
       frameBuffers.present();
+
+      // after present(), which waits for the frame being rendered
+      const drawing::DrawStats &drawStats = tileRenderer.drawStats();
+      SDL_SetWindowTitle(
+        window.window,
+        toString(
+          defaults::window::title, " render millis: ", sw.millis(),
+          ", sprites culled: ", drawStats.spritesCulled, "/", drawStats.spritesSubmitted,
+          ", pixels tested: ", drawStats.pixelsTested, ", written: ", drawStats.pixelsWritten).c_str());
+
+      #ifdef PROFILER
+      if (++frame % defaults::profiling::framesPerReport == 0)
+        for (const profiler::ZoneStats &zone: profiler::Profiler::instance().stats())
+          std::cout
+            << "zone " << zone.name << ": p50 " << zone.p50Millis << " ms, p99 " << zone.p99Millis
+            << " ms, max " << zone.maxMillis << " ms (" << zone.count << " samples)" << std::endl;
+      #endif
     }
 
+    #ifdef PROFILER
+    profiler::Profiler::instance().writeChromeTrace(defaults::paths::profileTrace);
+    std::cout << "wrote profile to " << defaults::paths::profileTrace << std::endl;
+    #endif
+
     //    SDL_Delay(3000);
     // TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING TESTING
     //----------------------------------------------------------------------------------------------------------------------
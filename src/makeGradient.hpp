@@ -10,6 +10,8 @@
 
 #include <function_traits.hpp>
 
+#include "drawing/kernels/active.hpp"
+
 namespace gradient
 {
   template<class V>
@@ -51,4 +53,54 @@ namespace gradient
       return glm::mix(a.v, nextIt->v, (t - a.t) * a.recipDiffToNext);
     };
   }
+
+  // Gradient from makeGradient sampled at entries evenly spaced values of t over [0, 1] (t outside that is clamped), and
+  // looked up by rounding t to the nearest sample: constant time where makeGradient's is a binary search, and with
+  // separate r, g and b arrays so that lookup8 can gather them (with AVX2, see drawing/kernels/packets.hpp).
+  // Rounding moves t by at most 0.5 / (entries - 1), which for the default entries is well below what 8 bit colors show
+  // unless the gradient's points are very close together.
+  class GradientTable
+  {
+  public:
+    explicit GradientTable(std::vector<std::pair<float, glm::vec3>> points, int entries = 1024)
+      : r(entries), g(entries), b(entries)
+    {
+      if (entries < 2)
+        throw std::runtime_error("GradientTable needs at least 2 entries");
+
+      const std::function<glm::vec3(float t)> gradient = makeGradient(std::move(points));
+
+      for (int i = 0; i < entries; ++i)
+      {
+        const glm::vec3 v = gradient((float)i / (float)(entries - 1));
+        (r[i] = v.x, g[i] = v.y, b[i] = v.z);
+      }
+    }
+
+    [[nodiscard]]
+    glm::vec3
+    operator()(float t) const
+    {
+      const int i = index(t);
+      return {r[i], g[i], b[i]};
+    }
+
+    // looks up 8 values of t at a time, as operator() does, with the kernel for whatever instruction set the CPU has
+    void
+    lookup8(const float *t, float *outr, float *outg, float *outb) const
+    {
+      drawing::kernels::active().lookupGradient8(r.data(), g.data(), b.data(), (int)r.size(), t, outr, outg, outb);
+    }
+
+  private:
+    std::vector<float> r, g, b;
+
+    [[nodiscard]]
+    int
+    index(float t) const
+    {
+      t = t > 0.f ? (t < 1.f ? t : 1.f) : 0.f; // written so that NaN gives 0
+      return (int)(t * (float)(r.size() - 1) + 0.5f);
+    }
+  };
 }
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+
 #include "CpuImageWithDepth.hpp"
+#include "drawing/kernels/active.hpp"
 
+// Bounds of the pixels of image which are not transparent, for shapes whose bounds can't be projected (see
+// Orthogonal::project), which are then rendered into a big enough image and trimmed.
+// Each row is only scanned inwards from its ends up to its first and last opaque pixels, by the drawing kernels.
 static void
 measureImageBounds(
   const ViewOfCpuImageWithDepth &image,
@@ -13,23 +20,20 @@ measureImageBounds(
   int _miny = image.h - 1;
   int _maxy = 0;
 
+  const drawing::kernels::Kernels &kernels = drawing::kernels::active();
+
   for (int y = 0; y < image.h; ++y)
   {
-    bool any = false;
-
-    for (int x = 0; x < image.w; ++x)
-      if (image.drgb[y * image.w + x] < 0xff000000)
-      {
-        any = true;
-        _minx = std::min(x, _minx);
-        _maxx = std::max(x, _maxx);
-      }
-
-    if (any)
-    {
-      _miny = std::min(y, _miny);
-      _maxy = std::max(y, _maxy);
-    }
+    const uint32_t *row = image.drgb + y * image.pitch;
+    const int first = kernels.firstOpaque(row, 0, image.w);
+
+    if (first == image.w)
+      continue;
+
+    _minx = std::min(first, _minx);
+    _maxx = std::max(kernels.lastOpaque(row, first, image.w), _maxx);
+    _miny = std::min(y, _miny);
+    _maxy = std::max(y, _maxy);
   }
 
   *minx = _minx;
@@ -6,6 +6,8 @@
 #include <glm/gtc/noise.hpp>
 
 #include "makeGradient.hpp"
+#include "perlin8.hpp"
+#include "raycasting/RayPacket.hpp"
 
 namespace noisyDiffuse
 {
@@ -14,5 +16,30 @@ namespace noisyDiffuse
   {
     return [=](glm::vec3 x) -> glm::vec3 { return gradientZeroToOne(0.5f + 0.5f * glm::perlin(x)); };
   }
-}
 
+  // Packet version of makeNoisyDiffuse(...)(x * scale), for the packet versions of shapes: the noise is perlin8 and the
+  // gradient a table lookup, so a packet is colored without a call per lane.
+  [[nodiscard]]
+  static
+  raycasting::PacketDiffuse
+  makeNoisyDiffuse8(gradient::GradientTable gradientZeroToOne, float scale = 1.f)
+  {
+    return [gradientZeroToOne = std::move(gradientZeroToOne), scale](raycasting::IntersectionPacket &intersections)
+    {
+      constexpr int size = raycasting::IntersectionPacket::size;
+      static_assert(size == 8);
+
+      float x[size], y[size], z[size], t[size];
+
+      for (int i = 0; i < size; ++i)
+        (x[i] = intersections.px[i] * scale, y[i] = intersections.py[i] * scale, z[i] = intersections.pz[i] * scale);
+
+      noise::perlin8(x, y, z, t);
+
+      for (int i = 0; i < size; ++i)
+        t[i] = 0.5f + 0.5f * t[i];
+
+      gradientZeroToOne.lookup8(t, intersections.dr, intersections.dg, intersections.db);
+    };
+  }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "drawing/kernels/active.hpp"
+
+namespace noise
+{
+  // perlin8
+  // 3D gradient noise of 8 points at a time, given as separate x, y and z arrays, written to out.
+  // The same classic Perlin noise as glm::perlin(glm::vec3) (hashing by permutation polynomial, gradients on an
+  // octahedron), with the kernel for whatever instruction set the CPU has (see drawing/kernels/packets.hpp), which all
+  // give the same results. Results can differ from glm::perlin's by rounding.
+  inline void
+  perlin8(const float *x, const float *y, const float *z, float *out)
+  {
+    drawing::kernels::active().perlin8(x, y, z, out);
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+namespace raycasting
+{
+  // World space bounding volume of a shape: every intersection with the shape is inside both the box
+  // center +/- halfAxes[0] +/- halfAxes[1] +/- halfAxes[2] and the sphere of radius around center, so a projection can
+  // use whichever is tighter. The box's axes needn't be aligned with the world's (a flat box fits a quad exactly).
+  struct Bounds
+  {
+    glm::vec3 center;
+    glm::vec3 halfAxes[3];
+    float radius;
+
+    [[nodiscard]]
+    static
+    Bounds
+    box(glm::vec3 min, glm::vec3 max)
+    {
+      const glm::vec3 halfSize = 0.5f * (max - min);
+
+      return {
+        .center = 0.5f * (min + max),
+        .halfAxes = {{halfSize.x, 0.f, 0.f}, {0.f, halfSize.y, 0.f}, {0.f, 0.f, halfSize.z}},
+        .radius = glm::length(halfSize)};
+    }
+
+    [[nodiscard]]
+    static
+    Bounds
+    sphere(glm::vec3 center, float radius)
+    {
+      return {
+        .center = center,
+        .halfAxes = {{radius, 0.f, 0.f}, {0.f, radius, 0.f}, {0.f, 0.f, radius}},
+        .radius = radius};
+    }
+
+    // dot(direction, x) over the points x in the bounds is within dot(direction, center) +/- this
+    [[nodiscard]]
+    float
+    extentAlong(glm::vec3 direction) const
+    {
+      const float boxExtent =
+        glm::abs(glm::dot(direction, halfAxes[0])) +
+        glm::abs(glm::dot(direction, halfAxes[1])) +
+        glm::abs(glm::dot(direction, halfAxes[2]));
+
+      return glm::min(boxExtent, radius * glm::length(direction));
+    }
+
+    // half the size of the world-aligned box around the bounds
+    [[nodiscard]]
+    glm::vec3
+    alignedHalfSize() const
+    {
+      return {extentAlong(glm::vec3{1.f, 0.f, 0.f}), extentAlong(glm::vec3{0.f, 1.f, 0.f}), extentAlong(glm::vec3{0.f, 0.f, 1.f})};
+    }
+  };
+}
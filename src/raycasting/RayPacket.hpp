@@ -0,0 +1,92 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <functional>
+
+#include <glm/vec3.hpp>
+
+#include "Intersection.hpp"
+#include "../drawing/kernels/Kernels.hpp"
+
+namespace raycasting
+{
+  // Rays which all share one direction, as from an orthographic camera.
+  // Stored as structure-of-arrays with a fixed lane count, for the packet kernels of the shapes (see
+  // drawing/kernels/Kernels.hpp), which intersect all the lanes at once for whatever instruction set the CPU has.
+  struct RayPacket
+  {
+    static constexpr int size = 8;
+
+    float ox[size], oy[size], oz[size];
+    glm::vec3 d;
+
+    [[nodiscard]] drawing::kernels::RayLanes
+    lanes() const {return {.ox = ox, .oy = oy, .oz = oz, .dx = d.x, .dy = d.y, .dz = d.z};}
+  };
+
+  struct IntersectionPacket
+  {
+    static constexpr int size = RayPacket::size;
+
+    float px[size], py[size], pz[size]; // position
+    float nx[size], ny[size], nz[size]; // normal
+    float dr[size], dg[size], db[size]; // diffuse
+    float distance[size];
+    uint32_t hits; // bit i is set if lane i intersected; other lanes are undefined
+
+    [[nodiscard]] drawing::kernels::IntersectionLanes
+    lanes() {return {.px = px, .py = py, .pz = pz, .nx = nx, .ny = ny, .nz = nz, .distance = distance};}
+
+    [[nodiscard]] bool
+    hit(int i) const {return hits >> i & 1;}
+
+    [[nodiscard]] Intersection
+    get(int i) const
+    {
+      return Intersection{
+        .position = {px[i], py[i], pz[i]},
+        .normal = {nx[i], ny[i], nz[i]},
+        .diffuse = {dr[i], dg[i], db[i]},
+        .distance = distance[i]};
+    }
+
+    void set(int i, const Intersection &intersection)
+    {
+      (px[i] = intersection.position.x, py[i] = intersection.position.y, pz[i] = intersection.position.z);
+      (nx[i] = intersection.normal.x, ny[i] = intersection.normal.y, nz[i] = intersection.normal.z);
+      (dr[i] = intersection.diffuse.x, dg[i] = intersection.diffuse.y, db[i] = intersection.diffuse.z);
+      distance[i] = intersection.distance;
+    }
+
+    void setDiffuse(glm::vec3 diffuse)
+    {
+      for (int i = 0; i < size; ++i)
+        (dr[i] = diffuse.x, dg[i] = diffuse.y, db[i] = diffuse.z);
+    }
+
+    void setDiffuse(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse)
+    {
+      forEachHit(
+        [&](int i)
+        {
+          glm::vec3 diffuse = xyzToDiffuse(glm::vec3{px[i], py[i], pz[i]});
+          (dr[i] = diffuse.x, dg[i] = diffuse.y, db[i] = diffuse.z);
+        });
+    }
+
+    // calls f(i) for each lane which intersected
+    void forEachHit(auto &&f) const
+    {
+      for (uint32_t remaining = hits; remaining; remaining &= remaining - 1)
+        f(std::countr_zero(remaining));
+    }
+  };
+
+  // Intersects a whole packet at a time; the packet counterpart of std::function<std::optional<Intersection>(Ray)>.
+  using PacketIntersector = std::function<void(const RayPacket &rays, IntersectionPacket &intersections)>;
+
+  // Colors a whole packet at a time, setting the diffuse of every lane from its position (lanes which missed can get
+  // anything); the packet counterpart of the std::function<glm::vec3(glm::vec3)> xyzToDiffuse taken by shapes.
+  using PacketDiffuse = std::function<void(IntersectionPacket &intersections)>;
+}
@@ -1,16 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <optional>
 
+#include <glm/geometric.hpp>
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
 #include <function_traits.hpp>
+#include <WorkerPool.hpp>
 
 #include "../../CpuImageWithDepth.hpp"
 
+#include "../Bounds.hpp"
 #include "../DirectionalLight.hpp"
 #include "../Intersection.hpp"
 #include "../Ray.hpp"
+#include "../RayPacket.hpp"
 
 namespace raycasting::cameras
 {
@@ -28,6 +35,7 @@ namespace raycasting::cameras
     // Orthogonal.render
     // Depth is centered at origin with uint8_t value 127.
     // Depth value 255 is reserved for rays which do not intersect anything or where the intersection distance is >= +128.0f.
+    // If pool is not nullptr then rows are split across its threads, so intersect must be safe to call concurrently.
     void
     render(
       const ViewOfCpuImageWithDepth &destImage,
@@ -35,13 +43,14 @@ namespace raycasting::cameras
       const glm::vec3 minLight,
       const DirectionalLight *directionalLights,
       int numDirectionalLights,
-      uint32_t defaultDrgb = 0xff000000)
+      uint32_t defaultDrgb = 0xff000000,
+      WorkerPool *pool = nullptr)
     const
     {
-      Ray ray{.direction = normal};
-
-      for (int y = 0; y < destImage.h; ++y)
+      auto renderRow = [&](size_t y)
       {
+        Ray ray{.direction = normal};
+
         glm::vec3 yOffset = ((float)destImage.h * -0.5f + (float)y + 0.5f) * ystep;
 
         for (int x = 0; x < destImage.w; ++x)
@@ -52,26 +61,156 @@ namespace raycasting::cameras
           uint32_t drgb;
 
           if (std::optional<Intersection> i = intersect(ray))
-          {
-            glm::vec3 lightSum{};
+            drgb = shade(*i, minLight, directionalLights, numDirectionalLights);
+          else
+            drgb = defaultDrgb;
+
+          int dindex = (int)y * destImage.pitch + x;
+          destImage.drgb[dindex] = drgb;
+        }
+      };
+
+      forEachRow(destImage.h, renderRow, pool);
+    }
 
-            for (int il = 0; il < numDirectionalLights; ++il)
-              lightSum += directionalLights[il].calculate(i->position, i->normal);
+    // Orthogonal.render8
+    // Same output as render, but intersects packets of RayPacket::size horizontally adjacent rays at a time.
+    // The last packet in a row is padded with rays past the right edge of the image, whose results are discarded.
+    void
+    render8(
+      const ViewOfCpuImageWithDepth &destImage,
+      Function<void(const RayPacket &rays, IntersectionPacket &intersections)> auto &&intersect,
+      const glm::vec3 minLight,
+      const DirectionalLight *directionalLights,
+      int numDirectionalLights,
+      uint32_t defaultDrgb = 0xff000000,
+      WorkerPool *pool = nullptr)
+    const
+    {
+      render8Window(
+        destImage,
+        {(float)destImage.w * 0.5f, (float)destImage.h * 0.5f},
+        intersect,
+        minLight,
+        directionalLights,
+        numDirectionalLights,
+        defaultDrgb,
+        pool);
+    }
 
-            lightSum = glm::clamp(lightSum, minLight, glm::vec3{1.f});
-            glm::vec3 color = 255.f * glm::clamp(lightSum * i->diffuse, glm::vec3{0.f}, glm::vec3{1.f});
+    // Orthogonal.render8Window
+    // Same as render8 but with the world origin at pixel coordinates origin of destImage rather than at its center,
+    // so that destImage can be a window into a bigger image, e.g. of just the pixels which project(...) returns.
+    void
+    render8Window(
+      const ViewOfCpuImageWithDepth &destImage,
+      glm::vec2 origin,
+      Function<void(const RayPacket &rays, IntersectionPacket &intersections)> auto &&intersect,
+      const glm::vec3 minLight,
+      const DirectionalLight *directionalLights,
+      int numDirectionalLights,
+      uint32_t defaultDrgb = 0xff000000,
+      WorkerPool *pool = nullptr)
+    const
+    {
+      auto renderRow = [&](size_t y)
+      {
+        RayPacket rays{.d = normal};
+        IntersectionPacket intersections;
 
-            auto depth = uint8_t(127.f + glm::clamp(i->distance, -127.f, 128.f));
+        glm::vec3 yOffset = ((float)y + 0.5f - origin.y) * ystep;
 
-            drgb = (depth << 24) | (uint32_t(color.x) << 16) | (uint32_t(color.y) << 8) | uint32_t(color.z);
+        for (int x0 = 0; x0 < destImage.w; x0 += RayPacket::size)
+        {
+          for (int i = 0; i < RayPacket::size; ++i)
+          {
+            glm::vec3 xOffset = ((float)(x0 + i) + 0.5f - origin.x) * xstep;
+            glm::vec3 rayOrigin = yOffset + xOffset; // the world origin is at pixel coordinates origin
+            (rays.ox[i] = rayOrigin.x, rays.oy[i] = rayOrigin.y, rays.oz[i] = rayOrigin.z);
           }
-          else
-            drgb = defaultDrgb;
 
-          int dindex = y * destImage.w + x;
-          destImage.drgb[dindex] = drgb;
+          intersect(rays, intersections);
+
+          uint32_t *pdest = destImage.drgb + (int)y * destImage.pitch + x0;
+          const int n = std::min(RayPacket::size, destImage.w - x0);
+
+          for (int i = 0; i < n; ++i)
+            pdest[i] = intersections.hit(i) ? shade(intersections.get(i), minLight, directionalLights, numDirectionalLights) : defaultDrgb;
         }
-      }
+      };
+
+      forEachRow(destImage.h, renderRow, pool);
+    }
+
+    // pixels of an image from render or render8, as the rectangle with top left pixel x, y and size w x h
+    struct PixelRect
+    {
+      int x, y, w, h;
+    };
+
+    // Orthogonal.project
+    // The pixels of an image of imageSize pixels rendered by render or render8 whose rays can intersect anything within
+    // bounds (empty if none), so that only those need to be rendered, into an image of just that size, with no need to
+    // look for the transparent pixels around a shape afterwards.
+    [[nodiscard]]
+    PixelRect
+    project(const Bounds &bounds, glm::ivec2 imageSize) const
+    {
+      // The ray through pixel x, y is ((x + 0.5 - w / 2) * xstep + (y + 0.5 - h / 2) * ystep + t * normal);
+      // the pixel coordinates of a world position come from solving for x and y by Cramer's rule.
+      const float det = glm::dot(xstep, glm::cross(ystep, normal));
+      const glm::vec3 toX = glm::cross(ystep, normal) / det, toY = glm::cross(normal, xstep) / det;
+
+      // a ray which only grazes the bounds is counted in, as rounding might make it hit
+      constexpr float margin = 0.001f;
+
+      auto range = [&](glm::vec3 toPixel, int size, int *min, int *max)
+      {
+        const float center = glm::dot(toPixel, bounds.center) + (float)size * 0.5f - 0.5f;
+        const float extent = bounds.extentAlong(toPixel) + margin;
+
+        *min = std::max((int)std::ceil(center - extent), 0);
+        *max = std::min((int)std::floor(center + extent), size - 1);
+      };
+
+      int minx, maxx, miny, maxy;
+      range(toX, imageSize.x, &minx, &maxx);
+      range(toY, imageSize.y, &miny, &maxy);
+
+      if (minx > maxx || miny > maxy)
+        return {.x = 0, .y = 0, .w = 0, .h = 0};
+
+      return {.x = minx, .y = miny, .w = maxx - minx + 1, .h = maxy - miny + 1};
+    }
+
+  private:
+    [[nodiscard]]
+    static
+    uint32_t
+    shade(const Intersection &i, const glm::vec3 minLight, const DirectionalLight *directionalLights, int numDirectionalLights)
+    {
+      glm::vec3 lightSum{};
+
+      for (int il = 0; il < numDirectionalLights; ++il)
+        lightSum += directionalLights[il].calculate(i.position, i.normal);
+
+      lightSum = glm::clamp(lightSum, minLight, glm::vec3{1.f});
+      glm::vec3 color = 255.f * glm::clamp(lightSum * i.diffuse, glm::vec3{0.f}, glm::vec3{1.f});
+
+      auto depth = uint8_t(127.f + glm::clamp(i.distance, -127.f, 128.f));
+
+      return (depth << 24) | (uint32_t(color.x) << 16) | (uint32_t(color.y) << 8) | uint32_t(color.z);
+    }
+
+    static
+    void
+    forEachRow(int h, auto &&renderRow, WorkerPool *pool)
+    {
+      if (pool)
+        pool->forEach(h, renderRow);
+      else
+        for (int y = 0; y < h; ++y)
+          renderRow(y);
     }
   };
 
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "../Bounds.hpp"
+#include "../Intersection.hpp"
+#include "../Ray.hpp"
+#include "../RayPacket.hpp"
+
+namespace raycasting::csg
+{
+  // An intersector along with the bounds of everything it can intersect.
+  template<typename Intersector>
+  struct Bounded
+  {
+    Intersector intersect;
+    Bounds bounds;
+  };
+
+  namespace detail
+  {
+    // Bounding volume hierarchy over the world-aligned boxes around a set of bounds, split by the surface area heuristic
+    // over binned centroids, and flattened depth first so that an inner node's first child directly follows it.
+    // Rays are lines here (intersections can be behind the ray origin, as Orthogonal renders depth on both sides of the
+    // camera plane), so a box is entered at the least t which is inside all three slabs, which may be negative.
+    class Bvh
+    {
+    public:
+      explicit Bvh(std::span<const Bounds> bounds)
+      {
+        items.resize(bounds.size());
+        std::iota(items.begin(), items.end(), uint32_t(0));
+
+        boxes.reserve(bounds.size());
+
+        for (const Bounds &b: bounds)
+        {
+          // a little bigger than the bounds, so that rounding in the slab test can't cull a ray which grazes them
+          const glm::vec3 halfSize = b.alignedHalfSize();
+          const glm::vec3 pad = 1e-4f * (glm::abs(b.center) + halfSize) + glm::vec3{1e-6f};
+          boxes.push_back(Box{.min = b.center - halfSize - pad, .max = b.center + halfSize + pad});
+        }
+
+        if (!items.empty())
+        {
+          nodes.reserve(2 * items.size());
+          build(0, (uint32_t)items.size(), 0);
+        }
+      }
+
+      // item i of the leaves is the order()[i]th bounds given to the constructor
+      [[nodiscard]] const std::vector<uint32_t> &
+      order() const {return items;}
+
+      // world-aligned box around all of the bounds
+      [[nodiscard]] Bounds
+      bounds() const
+      {
+        if (nodes.empty())
+          return Bounds::box(glm::vec3{0.f}, glm::vec3{0.f});
+
+        return Bounds::box(nodes[0].box.min, nodes[0].box.max);
+      }
+
+      // Calls visit(item) for each item of each leaf whose box the line o + t * d enters at t <= nearest, nearer leaves
+      // first, so that visit can lower nearest to skip what is behind what it has found. nearest must be finite: start
+      // it at std::numeric_limits<float>::max() for no limit.
+      void
+      forEachItemAlong(Ray ray, const float &nearest, auto &&visit) const
+      {
+        if (nodes.empty())
+          return;
+
+        const glm::vec3 inverseD = inverse(ray.d);
+
+        uint32_t stack[maxDepth];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0)
+        {
+          const Node &node = nodes[stack[--top]];
+
+          if (entry(node.box, ray.o, inverseD) > nearest)
+            continue;
+
+          if (node.count)
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+              visit(i);
+          else
+            pushChildren(node, ray.d, stack, top);
+        }
+      }
+
+      // Packet version of forEachItemAlong: calls visit(item, lanes) where bit i of lanes is set if ray i of rays
+      // enters the item's leaf at t <= nearest[i].
+      void
+      forEachItemAlong(const RayPacket &rays, const float (&nearest)[RayPacket::size], auto &&visit) const
+      {
+        if (nodes.empty())
+          return;
+
+        const glm::vec3 inverseD = inverse(rays.d);
+
+        uint32_t stack[maxDepth];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0)
+        {
+          const Node &node = nodes[stack[--top]];
+
+          uint32_t lanes = 0;
+
+          for (int i = 0; i < RayPacket::size; ++i)
+            lanes |= uint32_t(entry(node.box, glm::vec3{rays.ox[i], rays.oy[i], rays.oz[i]}, inverseD) <= nearest[i]) << i;
+
+          if (!lanes)
+            continue;
+
+          if (node.count)
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+              visit(i, lanes);
+          else
+            pushChildren(node, rays.d, stack, top); // the packet shares d so the order suits all of its lanes
+        }
+      }
+
+    private:
+      static constexpr uint32_t maxLeafItems = 4;
+      static constexpr int numBins = 12;
+      static constexpr int maxSurfaceAreaDepth = 48; // deeper than this, split by count so that the depth is bounded
+      static constexpr int maxDepth = maxSurfaceAreaDepth + 36; // of the tree, and so of the traversal stack
+
+      struct Box
+      {
+        glm::vec3 min{std::numeric_limits<float>::max()}, max{-std::numeric_limits<float>::max()};
+
+        void grow(const Box &other) {(min = glm::min(min, other.min), max = glm::max(max, other.max));}
+        void grow(glm::vec3 point) {(min = glm::min(min, point), max = glm::max(max, point));}
+
+        [[nodiscard]] glm::vec3
+        center() const {return 0.5f * (min + max);}
+
+        [[nodiscard]] float
+        halfArea() const
+        {
+          const glm::vec3 size = glm::max(max - min, glm::vec3{0.f});
+          return size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+      };
+
+      struct Node
+      {
+        Box box;
+        uint32_t first; // leaf: index of its first item; inner node: index of its second child
+        uint16_t count; // number of items in a leaf, 0 for an inner node
+        uint16_t axis; // inner node: axis along which its children were split, first child on the lower side
+      };
+
+      std::vector<Box> boxes; // by item as given to the constructor
+      std::vector<uint32_t> items;
+      std::vector<Node> nodes;
+
+      // 1 / d, with a huge but finite value for 0 so that the slab test of a ray lying in a slab's plane isn't 0 * inf
+      static glm::vec3
+      inverse(glm::vec3 d)
+      {
+        auto inverse1 = [](float x) {return x != 0.f ? 1.f / x : std::numeric_limits<float>::max();};
+        return {inverse1(d.x), inverse1(d.y), inverse1(d.z)};
+      }
+
+      // t at which o + t * d enters box, or +infinity if it misses it (so beyond any nearest, which is finite)
+      static float
+      entry(const Box &box, glm::vec3 o, glm::vec3 inverseD)
+      {
+        const glm::vec3 t0 = (box.min - o) * inverseD, t1 = (box.max - o) * inverseD;
+        const glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+        const float tEnter = std::max(std::max(tNear.x, tNear.y), tNear.z);
+        const float tExit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+
+        return tEnter <= tExit ? tEnter : std::numeric_limits<float>::infinity();
+      }
+
+      // pushes the far child first so that the near one is visited first
+      void
+      pushChildren(const Node &node, glm::vec3 d, uint32_t *stack, int &top) const
+      {
+        const uint32_t firstChild = uint32_t(&node - nodes.data()) + 1, secondChild = node.first;
+        const bool secondIsNearer = d[node.axis] < 0.f;
+
+        stack[top++] = secondIsNearer ? firstChild : secondChild;
+        stack[top++] = secondIsNearer ? secondChild : firstChild;
+      }
+
+      uint32_t
+      build(uint32_t begin, uint32_t end, int depth)
+      {
+        const auto index = (uint32_t)nodes.size();
+        nodes.emplace_back();
+
+        Box box, centroids;
+
+        for (uint32_t i = begin; i < end; ++i)
+          (box.grow(boxes[items[i]]), centroids.grow(boxes[items[i]].center()));
+
+        const uint32_t count = end - begin;
+
+        const glm::vec3 extent = centroids.max - centroids.min;
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+        if (count <= maxLeafItems)
+        {
+          nodes[index] = Node{.box = box, .first = begin, .count = (uint16_t)count, .axis = 0};
+          return index;
+        }
+
+        uint32_t mid = extent[axis] > 0.f && depth < maxSurfaceAreaDepth ? partitionBySurfaceArea(begin, end, axis, centroids) : begin;
+
+        if (mid == begin || mid == end)
+        {
+          // all centroids in one bin (or all the same), or too deep: split by count instead
+          mid = begin + count / 2;
+          std::nth_element(
+            items.begin() + begin, items.begin() + mid, items.begin() + end,
+            [&](uint32_t a, uint32_t b) {return boxes[a].center()[axis] < boxes[b].center()[axis];});
+        }
+
+        build(begin, mid, depth + 1);
+        const uint32_t secondChild = build(mid, end, depth + 1);
+
+        nodes[index] = Node{.box = box, .first = secondChild, .count = 0, .axis = (uint16_t)axis};
+        return index;
+      }
+
+      // Partitions items [begin, end) at the bin boundary along axis which minimizes the surface area heuristic, and
+      // returns the index of the first item on the upper side.
+      uint32_t
+      partitionBySurfaceArea(uint32_t begin, uint32_t end, int axis, const Box &centroids)
+      {
+        const float binScale = (float)numBins / (centroids.max[axis] - centroids.min[axis]);
+
+        auto binOf = [&](uint32_t item)
+        {
+          return std::min((int)((boxes[item].center()[axis] - centroids.min[axis]) * binScale), numBins - 1);
+        };
+
+        std::array<Box, numBins> binBoxes{};
+        std::array<uint32_t, numBins> binCounts{};
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+          const int bin = binOf(items[i]);
+          binBoxes[bin].grow(boxes[items[i]]);
+          ++binCounts[bin];
+        }
+
+        // cost of splitting after bin i is the number of items on each side times its area, summed
+        std::array<float, numBins - 1> lowerCost{};
+        Box lower;
+        uint32_t lowerCount = 0;
+
+        for (int i = 0; i < numBins - 1; ++i)
+        {
+          (lower.grow(binBoxes[i]), lowerCount += binCounts[i]);
+          lowerCost[i] = (float)lowerCount * lower.halfArea();
+        }
+
+        Box upper;
+        uint32_t upperCount = 0;
+        float bestCost = std::numeric_limits<float>::max();
+        int bestSplit = 0;
+
+        for (int i = numBins - 1; i > 0; --i)
+        {
+          (upper.grow(binBoxes[i]), upperCount += binCounts[i]);
+
+          if (const float cost = lowerCost[i - 1] + (float)upperCount * upper.halfArea(); cost < bestCost)
+            (bestCost = cost, bestSplit = i);
+        }
+
+        const auto upperBegin = std::partition(
+          items.begin() + begin, items.begin() + end,
+          [&](uint32_t item) {return binOf(item) < bestSplit;});
+
+        return (uint32_t)(upperBegin - items.begin());
+      }
+    };
+  }
+
+  // Same as makeUnion, but a bounding volume hierarchy over the intersectors' bounds picks out which of them a ray can
+  // intersect, nearest first, and stops once the rest are all behind what it has found; so for many small shapes the
+  // cost per ray grows with the log of their number rather than linearly.
+  // Returns the bounds of the union too, so that it can be projected or be part of another union.
+  [[nodiscard]]
+  static
+  Bounded<std::function<std::optional<Intersection>(Ray ray)>>
+  makeBvhUnion(std::vector<Bounded<std::function<std::optional<Intersection>(Ray ray)>>> intersectors)
+  {
+    std::vector<Bounds> bounds;
+    for (const auto &intersector: intersectors)
+      bounds.push_back(intersector.bounds);
+
+    detail::Bvh bvh{bounds};
+
+    // in the order of the leaves
+    std::vector<std::function<std::optional<Intersection>(Ray ray)>> ordered;
+    for (uint32_t i: bvh.order())
+      ordered.push_back(std::move(intersectors[i].intersect));
+
+    const Bounds unionBounds = bvh.bounds();
+
+    return {
+      .intersect =
+        [bvh = std::move(bvh), intersectors = std::move(ordered)](Ray ray)
+        {
+          std::optional<Intersection> intersection{};
+          float nearest = std::numeric_limits<float>::max();
+
+          bvh.forEachItemAlong(
+            ray, nearest,
+            [&](uint32_t i)
+            {
+              if (std::optional<Intersection> thisIntersection = intersectors[i](ray))
+                if (nearest > thisIntersection->distance)
+                  (intersection = thisIntersection, nearest = thisIntersection->distance);
+            });
+
+          return intersection;
+        },
+      .bounds = unionBounds};
+  }
+
+  // packet version of makeBvhUnion, as makeUnion8 is of makeUnion
+  [[nodiscard]]
+  static
+  Bounded<PacketIntersector>
+  makeBvhUnion8(std::vector<Bounded<PacketIntersector>> intersectors)
+  {
+    std::vector<Bounds> bounds;
+    for (const auto &intersector: intersectors)
+      bounds.push_back(intersector.bounds);
+
+    detail::Bvh bvh{bounds};
+
+    std::vector<PacketIntersector> ordered;
+    for (uint32_t i: bvh.order())
+      ordered.push_back(std::move(intersectors[i].intersect));
+
+    const Bounds unionBounds = bvh.bounds();
+
+    return {
+      .intersect =
+        [bvh = std::move(bvh), intersectors = std::move(ordered)](const RayPacket &rays, IntersectionPacket &intersections)
+        {
+          intersections.hits = 0;
+
+          float nearest[RayPacket::size];
+          std::fill_n(nearest, RayPacket::size, std::numeric_limits<float>::max());
+
+          IntersectionPacket thisIntersections;
+
+          bvh.forEachItemAlong(
+            rays, nearest,
+            [&](uint32_t item, uint32_t lanes)
+            {
+              intersectors[item](rays, thisIntersections);
+
+              // lanes where this intersection is the nearest so far
+              uint32_t take = 0;
+
+              for (int i = 0; i < IntersectionPacket::size; ++i)
+                take |= uint32_t(thisIntersections.hit(i) && nearest[i] > thisIntersections.distance[i]) << i;
+
+              thisIntersections.hits = take & lanes;
+              thisIntersections.forEachHit(
+                [&](int i)
+                {
+                  intersections.set(i, thisIntersections.get(i));
+                  nearest[i] = thisIntersections.distance[i];
+                });
+              intersections.hits |= thisIntersections.hits;
+            });
+        },
+      .bounds = unionBounds};
+  }
+}
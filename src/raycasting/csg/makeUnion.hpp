@@ -4,11 +4,38 @@
 #include <optional>
 #include <vector>
 
+#include <function_traits.hpp>
+
 #include "../Intersection.hpp"
 #include "../Ray.hpp"
+#include "../RayPacket.hpp"
 
 namespace raycasting::csg
 {
+  // Union of a fixed set of intersectors, composing with shapes::sphere etc. into a single inlinable type.
+  // Use makeUnion for a set which is only known at run-time.
+  [[nodiscard]]
+  static
+  auto
+  unionOf(Function<std::optional<Intersection>(Ray ray)> auto... intersectors)
+  {
+    return [=](Ray ray) -> std::optional<Intersection>
+    {
+      std::optional<Intersection> intersection{};
+
+      auto nearest = [&](const auto &intersector)
+      {
+        if (std::optional<Intersection> thisIntersection = intersector(ray))
+          if (!intersection || intersection->distance > thisIntersection->distance)
+            intersection = thisIntersection;
+      };
+
+      (nearest(intersectors), ...);
+
+      return intersection;
+    };
+  }
+
   [[nodiscard]]
   static
   std::function<std::optional<Intersection>(Ray ray)>
@@ -26,4 +53,32 @@ namespace raycasting::csg
       return intersection;
     };
   }
+
+  [[nodiscard]]
+  static
+  PacketIntersector
+  makeUnion8(std::vector<PacketIntersector> intersectors)
+  {
+    return [intersectors = std::move(intersectors)](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      intersections.hits = 0;
+
+      IntersectionPacket thisIntersections;
+
+      for (const auto &intersector: intersectors)
+      {
+        intersector(rays, thisIntersections);
+
+        // lanes where this intersection is the nearest so far
+        uint32_t take = 0;
+
+        for (int i = 0; i < IntersectionPacket::size; ++i)
+          take |= uint32_t(thisIntersections.hit(i) && (!intersections.hit(i) || intersections.distance[i] > thisIntersections.distance[i])) << i;
+
+        thisIntersections.hits = take;
+        thisIntersections.forEachHit([&](int i) {intersections.set(i, thisIntersections.get(i));});
+        intersections.hits |= take;
+      }
+    };
+  }
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <concepts>
 #include <functional>
 #include <optional>
 #include <stdexcept>
@@ -7,8 +8,11 @@
 #include <glm/vec2.hpp>
 #include <glm/geometric.hpp>
 
+#include "../Bounds.hpp"
 #include "../Intersection.hpp"
 #include "../Ray.hpp"
+#include "../RayPacket.hpp"
+#include "../../drawing/kernels/active.hpp"
 
 namespace raycasting::shapes
 {
@@ -97,13 +101,21 @@ namespace raycasting::shapes
           .normal = glm::normalize(glm::vec3(glm::normalize(glm::vec2(isect_and_d->first)), zslope)),
           .distance = isect_and_d->second};
       }
+
+      // same as intersect(Ray) for each lane, with the kernel for whatever instruction set the CPU has
+      void
+      intersect(const RayPacket &rays, IntersectionPacket &intersections) const
+      {
+        const drawing::kernels::ConeParameters cone{.sqradius = sqradius, .minz = minz, .maxz = maxz, .zslope = zslope};
+        intersections.hits = drawing::kernels::active().intersectCone8(cone, rays.lanes(), intersections.lanes());
+      }
     };
   }
 
   [[nodiscard]]
   static
-  std::function<std::optional<Intersection>(Ray ray)>
-  makeCone(glm::vec3 diffuse, float height, float radiusAtHeight) // height can be negative
+  auto
+  cone(glm::vec3 diffuse, float height, float radiusAtHeight) // height can be negative
   {
     return [=, cone = detail::Cone{height, radiusAtHeight}](Ray ray) -> std::optional<Intersection>
     {
@@ -114,8 +126,8 @@ namespace raycasting::shapes
 
   [[nodiscard]]
   static
-  std::function<std::optional<Intersection>(Ray ray)>
-  makeCone(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, float height, float radiusAtHeight) // height can be negative
+  auto
+  cone(std::invocable<glm::vec3> auto xyzToDiffuse, float height, float radiusAtHeight) // height can be negative
   {
     return [=, cone = detail::Cone{height, radiusAtHeight}](Ray ray) -> std::optional<Intersection>
     {
@@ -123,4 +135,67 @@ namespace raycasting::shapes
       return i ? (i->diffuse = xyzToDiffuse(i->position), i) : i;
     };
   }
-}
\ No newline at end of file
+
+  [[nodiscard]]
+  static
+  std::function<std::optional<Intersection>(Ray ray)>
+  makeCone(glm::vec3 diffuse, float height, float radiusAtHeight) // height can be negative
+  {
+    return cone(diffuse, height, radiusAtHeight);
+  }
+
+  [[nodiscard]]
+  static
+  std::function<std::optional<Intersection>(Ray ray)>
+  makeCone(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, float height, float radiusAtHeight) // height can be negative
+  {
+    return cone(xyzToDiffuse, height, radiusAtHeight);
+  }
+
+  [[nodiscard]]
+  static
+  PacketIntersector
+  makeCone8(glm::vec3 diffuse, float height, float radiusAtHeight) // height can be negative
+  {
+    return [=, cone = detail::Cone{height, radiusAtHeight}](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      cone.intersect(rays, intersections);
+      intersections.setDiffuse(diffuse);
+    };
+  }
+
+  [[nodiscard]]
+  static
+  PacketIntersector
+  makeCone8(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, float height, float radiusAtHeight) // height can be negative
+  {
+    return [=, cone = detail::Cone{height, radiusAtHeight}](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      cone.intersect(rays, intersections);
+      intersections.setDiffuse(xyzToDiffuse);
+    };
+  }
+
+  [[nodiscard]]
+  static
+  PacketIntersector
+  makeCone8(const PacketDiffuse &diffuse8, float height, float radiusAtHeight) // height can be negative
+  {
+    return [=, cone = detail::Cone{height, radiusAtHeight}](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      cone.intersect(rays, intersections);
+      diffuse8(intersections);
+    };
+  }
+
+  // bounds of the cones above with this height and radiusAtHeight
+  [[nodiscard]]
+  static
+  Bounds
+  coneBounds(float height, float radiusAtHeight) // height can be negative
+  {
+    return Bounds::box(
+      glm::vec3{-radiusAtHeight, -radiusAtHeight, glm::min(height, 0.f)},
+      glm::vec3{radiusAtHeight, radiusAtHeight, glm::max(height, 0.f)});
+  }
+}
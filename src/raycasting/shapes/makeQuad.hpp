@@ -1,11 +1,16 @@
 #pragma once
 
+#include <concepts>
+#include <functional>
 #include <optional>
 
 #include <glm/geometric.hpp>
 
+#include "../Bounds.hpp"
 #include "../Intersection.hpp"
 #include "../Ray.hpp"
+#include "../RayPacket.hpp"
+#include "../../drawing/kernels/active.hpp"
 
 namespace raycasting::shapes
 {
@@ -47,14 +52,25 @@ namespace raycasting::shapes
 
         return Intersection{.position = isect, .normal = n, .distance = t};
       }
+
+      // same as intersect(Ray) for each lane, with the kernel for whatever instruction set the CPU has
+      void
+      intersect(const RayPacket &rays, IntersectionPacket &intersections) const
+      {
+        const drawing::kernels::QuadParameters quad{
+          .cx = center.x, .cy = center.y, .cz = center.z, .nx = n.x, .ny = n.y, .nz = n.z,
+          .ax = a.x, .ay = a.y, .az = a.z, .bx = b.x, .by = b.y, .bz = b.z, .al2 = al2, .bl2 = bl2};
+
+        intersections.hits = drawing::kernels::active().intersectQuad8(quad, rays.lanes(), intersections.lanes());
+      }
     };
   }
 
   static
-  std::function<std::optional<Intersection>(Ray ray)>
-  makeQuad(glm::vec3 diffuse, glm::vec3 center, glm::vec3 a, glm::vec3 b)
+  auto
+  quad(glm::vec3 diffuse, glm::vec3 center, glm::vec3 a, glm::vec3 b)
   {
-    return [=, quad = detail::Quad(center, a, b)](Ray ray)
+    return [=, quad = detail::Quad(center, a, b)](Ray ray) -> std::optional<Intersection>
     {
       auto i = quad.intersect(ray);
       return i ? (i->diffuse = diffuse, i) : i;
@@ -62,13 +78,74 @@ namespace raycasting::shapes
   }
 
   static
-  std::function<std::optional<Intersection>(Ray ray)>
-  makeQuad(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, glm::vec3 center, glm::vec3 a, glm::vec3 b)
+  auto
+  quad(std::invocable<glm::vec3> auto xyzToDiffuse, glm::vec3 center, glm::vec3 a, glm::vec3 b)
   {
-    return [=, quad = detail::Quad(center, a, b)](Ray ray)
+    return [=, quad = detail::Quad(center, a, b)](Ray ray) -> std::optional<Intersection>
     {
       auto i = quad.intersect(ray);
       return i ? (i->diffuse = xyzToDiffuse(i->position), i) : i;
     };
   }
-}
\ No newline at end of file
+
+  static
+  std::function<std::optional<Intersection>(Ray ray)>
+  makeQuad(glm::vec3 diffuse, glm::vec3 center, glm::vec3 a, glm::vec3 b)
+  {
+    return quad(diffuse, center, a, b);
+  }
+
+  static
+  std::function<std::optional<Intersection>(Ray ray)>
+  makeQuad(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, glm::vec3 center, glm::vec3 a, glm::vec3 b)
+  {
+    return quad(xyzToDiffuse, center, a, b);
+  }
+
+  static
+  PacketIntersector
+  makeQuad8(glm::vec3 diffuse, glm::vec3 center, glm::vec3 a, glm::vec3 b)
+  {
+    return [=, quad = detail::Quad(center, a, b)](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      quad.intersect(rays, intersections);
+      intersections.setDiffuse(diffuse);
+    };
+  }
+
+  static
+  PacketIntersector
+  makeQuad8(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, glm::vec3 center, glm::vec3 a, glm::vec3 b)
+  {
+    return [=, quad = detail::Quad(center, a, b)](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      quad.intersect(rays, intersections);
+      intersections.setDiffuse(xyzToDiffuse);
+    };
+  }
+
+  [[nodiscard]]
+  static
+  PacketIntersector
+  makeQuad8(const PacketDiffuse &diffuse8, glm::vec3 center, glm::vec3 a, glm::vec3 b)
+  {
+    return [=, quad = detail::Quad(center, a, b)](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      quad.intersect(rays, intersections);
+      diffuse8(intersections);
+    };
+  }
+
+  // bounds of the quads above with this center, a and b, which span center +/- a +/- b when a and b are perpendicular
+  // (as they are meant to be: the quad is the points of its plane within |a| along a and |b| along b of center)
+  [[nodiscard]]
+  static
+  Bounds
+  quadBounds(glm::vec3 center, glm::vec3 a, glm::vec3 b)
+  {
+    return {
+      .center = center,
+      .halfAxes = {a, b, glm::vec3{0.f}},
+      .radius = glm::max(glm::length(a + b), glm::length(a - b))};
+  }
+}
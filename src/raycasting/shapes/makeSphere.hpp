@@ -1,13 +1,17 @@
 #pragma once
 
+#include <concepts>
 #include <functional>
 #include <optional>
 
 #include <glm/geometric.hpp>
 #include <glm/vec3.hpp>
 
+#include "../Bounds.hpp"
 #include "../Intersection.hpp"
 #include "../Ray.hpp"
+#include "../RayPacket.hpp"
+#include "../../drawing/kernels/active.hpp"
 
 namespace raycasting::shapes
 {
@@ -50,13 +54,24 @@ namespace raycasting::shapes
         intersection.normal = glm::normalize(intersection.position - center);
         return intersection;
       }
+
+      // same as intersect(Ray) for each lane, with the kernel for whatever instruction set the CPU has
+      void
+      intersect(const RayPacket &rays, IntersectionPacket &intersections) const
+      {
+        const drawing::kernels::SphereParameters sphere{.cx = center.x, .cy = center.y, .cz = center.z, .sqradius = sqradius};
+        intersections.hits = drawing::kernels::active().intersectSphere8(sphere, rays.lanes(), intersections.lanes());
+      }
     };
   }
 
+  // sphere, quad, cone etc. return concrete types which compose (through csg::unionOf, transform::translated etc.)
+  // into a single type that the compiler can inline; makeSphere, makeQuad, makeCone etc. wrap them in a std::function.
+
   [[nodiscard]]
   static
-  std::function<std::optional<Intersection>(Ray)>
-  makeSphere(glm::vec3 diffuse, glm::vec3 center, float radius)
+  auto
+  sphere(glm::vec3 diffuse, glm::vec3 center, float radius)
   {
     return [=, sphere = detail::Sphere{center, radius}](Ray ray) -> std::optional<Intersection>
     {
@@ -67,8 +82,8 @@ namespace raycasting::shapes
 
   [[nodiscard]]
   static
-  std::function<std::optional<Intersection>(Ray)>
-  makeSphere(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, glm::vec3 center, float radius)
+  auto
+  sphere(std::invocable<glm::vec3> auto xyzToDiffuse, glm::vec3 center, float radius)
   {
     return [=, sphere = detail::Sphere{center, radius}](Ray ray) -> std::optional<Intersection>
     {
@@ -76,4 +91,65 @@ namespace raycasting::shapes
       return i ? (i->diffuse = xyzToDiffuse(i->position), i) : i;
     };
   }
-}
\ No newline at end of file
+
+  [[nodiscard]]
+  static
+  std::function<std::optional<Intersection>(Ray)>
+  makeSphere(glm::vec3 diffuse, glm::vec3 center, float radius)
+  {
+    return sphere(diffuse, center, radius);
+  }
+
+  [[nodiscard]]
+  static
+  std::function<std::optional<Intersection>(Ray)>
+  makeSphere(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, glm::vec3 center, float radius)
+  {
+    return sphere(xyzToDiffuse, center, radius);
+  }
+
+  [[nodiscard]]
+  static
+  PacketIntersector
+  makeSphere8(glm::vec3 diffuse, glm::vec3 center, float radius)
+  {
+    return [=, sphere = detail::Sphere{center, radius}](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      sphere.intersect(rays, intersections);
+      intersections.setDiffuse(diffuse);
+    };
+  }
+
+  [[nodiscard]]
+  static
+  PacketIntersector
+  makeSphere8(const std::function<glm::vec3(glm::vec3)> &xyzToDiffuse, glm::vec3 center, float radius)
+  {
+    return [=, sphere = detail::Sphere{center, radius}](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      sphere.intersect(rays, intersections);
+      intersections.setDiffuse(xyzToDiffuse);
+    };
+  }
+
+  [[nodiscard]]
+  static
+  PacketIntersector
+  makeSphere8(const PacketDiffuse &diffuse8, glm::vec3 center, float radius)
+  {
+    return [=, sphere = detail::Sphere{center, radius}](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      sphere.intersect(rays, intersections);
+      diffuse8(intersections);
+    };
+  }
+
+  // bounds of the spheres above with this center and radius
+  [[nodiscard]]
+  static
+  Bounds
+  sphereBounds(glm::vec3 center, float radius)
+  {
+    return Bounds::sphere(center, radius);
+  }
+}
@@ -3,13 +3,19 @@
 #include <functional>
 #include <optional>
 
+#include <function_traits.hpp>
+
+#include "../Bounds.hpp"
 #include "../Intersection.hpp"
 #include "../Ray.hpp"
+#include "../RayPacket.hpp"
 
 namespace raycasting::transform
 {
-  std::function<std::optional<Intersection>(Ray)>
-  translate(const std::function<std::optional<Intersection>(Ray)> &function, glm::vec3 offset)
+  // composes with shapes::sphere etc. into a single inlinable type; translate is the same through std::function
+  [[nodiscard]]
+  auto
+  translated(Function<std::optional<Intersection>(Ray)> auto function, glm::vec3 offset)
   {
     return [=](Ray ray) -> std::optional<Intersection>
     {
@@ -23,4 +29,37 @@ namespace raycasting::transform
         return std::nullopt;
     };
   }
+
+  std::function<std::optional<Intersection>(Ray)>
+  translate(const std::function<std::optional<Intersection>(Ray)> &function, glm::vec3 offset)
+  {
+    return translated(function, offset);
+  }
+
+  PacketIntersector
+  translate8(const PacketIntersector &function, glm::vec3 offset)
+  {
+    return [=](const RayPacket &rays, IntersectionPacket &intersections)
+    {
+      RayPacket translated{rays};
+
+      for (int i = 0; i < RayPacket::size; ++i)
+        (translated.ox[i] -= offset.x, translated.oy[i] -= offset.y, translated.oz[i] -= offset.z);
+
+      function(translated, intersections);
+
+      // lanes which missed are undefined anyway
+      for (int i = 0; i < RayPacket::size; ++i)
+        (intersections.px[i] += offset.x, intersections.py[i] += offset.y, intersections.pz[i] += offset.z);
+    };
+  }
+
+  // bounds of what translate or translate8 returns, given the bounds of function
+  [[nodiscard]]
+  Bounds
+  translate(Bounds bounds, glm::vec3 offset)
+  {
+    bounds.center += offset;
+    return bounds;
+  }
 }
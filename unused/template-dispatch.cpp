@@ -18,6 +18,8 @@
 // This solution allows the point of use to specify a template struct as a template parameter
 // to the image blending function, where the template struct may have specializations for SIMD,
 // and the point of use does not need to know that.
+//
+// (Since shipped as the blend operators of src/drawing/blending/BlendOps.hpp, for drawDepthVolume.)
 
 #include <cstdint>
 #include <iostream>
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+  #include <sys/mman.h>
+#endif
+
+#include "NoCopyNoMove.hpp"
+
+// Bump allocator: allocations are carved out of large blocks and all freed at once by reset(), which is O(1) once the
+// arena has grown to fit everything allocated between resets, so a repeat of the same allocations never touches the
+// heap. Blocks are cache-line aligned, or with hugePages 2 MiB aligned and sized (and on Linux advised to use
+// transparent huge pages), which cuts TLB misses over big buffers like frame buffers.
+// Only for trivially destructible types, since nothing is destroyed; allocate and reset from one thread at a time.
+class Arena : NoCopyNoMove
+{
+public:
+  static constexpr size_t cacheLineBytes = 64;
+  static constexpr size_t hugePageBytes = size_t(2) << 20;
+
+  // blockBytes is the size of the first block; a block which is outgrown is followed by one at least twice as big
+  explicit Arena(size_t blockBytes = size_t(1) << 20, bool hugePages = false)
+    : hugePages{hugePages}
+  {
+    addBlock(blockBytes);
+  }
+
+  ~Arena()
+  {
+    for (const Block &block: blocks)
+      freeBlock(block);
+  }
+
+  // Uninitialized memory for n objects of type T, aligned to at least a cache line.
+  template<typename T>
+  [[nodiscard]] T *
+  allocate(size_t n)
+  {
+    static_assert(std::is_trivially_destructible_v<T>, "Arena never destroys what it allocates");
+    static_assert(alignof(T) <= cacheLineBytes);
+
+    const size_t bytes = std::max(n * sizeof(T), size_t(1));
+
+    if (blocks.back().used + bytes > blocks.back().size)
+      addBlock(std::max(bytes, blocks.back().size * 2));
+
+    Block &block = blocks.back();
+    void *p = block.memory + block.used;
+    block.used += alignUp(bytes, cacheLineBytes);
+
+    return (T *)p;
+  }
+
+  // Like allocate but zeroed, as std::make_unique<T[]> would be.
+  template<typename T>
+  [[nodiscard]] T *
+  allocateZeroed(size_t n)
+  {
+    T *p = allocate<T>(n);
+    std::memset((void *)p, 0, n * sizeof(T));
+    return p;
+  }
+
+  // Frees everything allocated so far. If that took more than one block, they are replaced with one block big enough
+  // for all of it, so that repeating the same allocations doesn't allocate again.
+  void reset()
+  {
+    if (blocks.size() > 1)
+    {
+      size_t total = 0;
+
+      for (const Block &block: blocks)
+      {
+        total += block.used;
+        freeBlock(block);
+      }
+
+      blocks.clear();
+      addBlock(total);
+    }
+
+    blocks.back().used = 0;
+  }
+
+  // bytes in use, including alignment padding
+  [[nodiscard]] size_t
+  used() const
+  {
+    size_t total = 0;
+
+    for (const Block &block: blocks)
+      total += block.used;
+
+    return total;
+  }
+
+private:
+  struct Block
+  {
+    std::byte *memory;
+    size_t size, used;
+  };
+
+  const bool hugePages;
+  std::vector<Block> blocks;
+
+  static size_t alignUp(size_t x, size_t alignment) {return (x + alignment - 1) & ~(alignment - 1);}
+
+  [[nodiscard]] size_t
+  blockAlignment() const {return hugePages ? hugePageBytes : cacheLineBytes;}
+
+  void addBlock(size_t bytes)
+  {
+    const size_t size = alignUp(std::max(bytes, size_t(1)), blockAlignment());
+    auto *memory = (std::byte *)::operator new(size, std::align_val_t{blockAlignment()});
+
+    #ifdef __linux__
+    if (hugePages)
+      madvise(memory, size, MADV_HUGEPAGE); // only advice: without transparent huge pages this changes nothing
+    #endif
+
+    blocks.push_back(Block{.memory = memory, .size = size, .used = 0});
+  }
+
+  void freeBlock(const Block &block) const
+  {
+    ::operator delete(block.memory, std::align_val_t{blockAlignment()});
+  }
+};
+
+// Owner of an array which is either on the heap, or in an arena (which frees it along with everything else, so then
+// this frees nothing).
+template<typename T>
+struct ArenaOrHeapDelete
+{
+  bool heap{true};
+
+  void operator()(T *p) const
+  {
+    if (heap)
+      delete[] p;
+  }
+};
+
+template<typename T>
+using ArenaOrHeapArray = std::unique_ptr<T[], ArenaOrHeapDelete<T>>;
+
+// n zeroed objects, in arena if it isn't nullptr, otherwise on the heap.
+template<typename T>
+[[nodiscard]] ArenaOrHeapArray<T>
+makeArenaOrHeapArray(size_t n, Arena *arena)
+{
+  if (arena)
+    return {arena->allocateZeroed<T>(n), ArenaOrHeapDelete<T>{.heap = false}};
+
+  return {new T[n](), ArenaOrHeapDelete<T>{.heap = true}};
+}
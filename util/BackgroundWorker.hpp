@@ -0,0 +1,124 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "function_traits.hpp"
+#include "NoCopyNoMove.hpp"
+
+// One thread which runs one job at a time in the background, like std::async with a single future outstanding,
+// except that starting a job neither creates a thread nor allocates.
+// start and wait are not reentrant: call them from one thread at a time.
+class BackgroundWorker : NoCopyNoMove
+{
+public:
+  BackgroundWorker() : thread{[this] {workerLoop();}} {}
+
+  // waits for a job still running
+  ~BackgroundWorker()
+  {
+    {
+      std::unique_lock lock{mutex};
+      done.wait(lock, [&] {return !running;});
+      quit = true;
+    }
+    wake.notify_one();
+
+    thread.join();
+  }
+
+  // Waits for the last job (discarding anything it threw) then starts calling f() on the worker thread;
+  // f must stay valid until wait() returns.
+  void start(Function<void()> auto &f)
+  {
+    using F = std::remove_reference_t<decltype(f)>;
+
+    {
+      std::unique_lock lock{mutex};
+      done.wait(lock, [&] {return !running;});
+      job = {.call = [](void *context) {(*(F *)context)();}, .context = (void *)&f};
+      error = nullptr;
+      running = pending = true;
+    }
+    wake.notify_one();
+  }
+
+  // true from start() until wait() returns
+  [[nodiscard]] bool
+  isPending() const {return pending;}
+
+  // Waits for the job started last to finish, and rethrows anything it threw; does nothing if there is none.
+  void wait()
+  {
+    if (!pending)
+      return;
+
+    std::exception_ptr thrown;
+
+    {
+      std::unique_lock lock{mutex};
+      done.wait(lock, [&] {return !running;});
+      pending = false;
+      thrown = std::exchange(error, nullptr);
+    }
+
+    if (thrown)
+      std::rethrow_exception(thrown);
+  }
+
+private:
+  struct Job
+  {
+    void (*call)(void *context);
+    void *context;
+  };
+
+  std::mutex mutex;
+  std::condition_variable wake, done;
+  Job job{}; // guarded by mutex
+  std::exception_ptr error; // guarded by mutex
+  bool running{false}; // guarded by mutex
+  bool quit{false}; // guarded by mutex
+  bool pending{false}; // only used by the thread calling start and wait
+  std::thread thread; // last, so that everything above is initialized before the thread starts
+
+  void workerLoop()
+  {
+    for (;;)
+    {
+      Job thisJob;
+
+      {
+        std::unique_lock lock{mutex};
+        wake.wait(lock, [&] {return quit || running;});
+
+        if (quit)
+          return;
+
+        thisJob = job;
+      }
+
+      std::exception_ptr thrown;
+
+      try
+      {
+        thisJob.call(thisJob.context);
+      }
+      catch (...)
+      {
+        thrown = std::current_exception();
+      }
+
+      {
+        std::lock_guard lock{mutex};
+        error = thrown;
+        running = false;
+      }
+      done.notify_all();
+    }
+  }
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Instruction set extensions of the CPU the program is running on, which the OS also saves the registers of.
+// All false on other than x86.
+struct CpuFeatures
+{
+  bool sse41{false};
+  bool avx2{false};
+  bool avx512bw{false}; // with AVX-512 F, DQ and VL too, as every CPU with BW has (and as MSVC's /arch:AVX512 assumes)
+
+  static
+  CpuFeatures
+  detect()
+  {
+    CpuFeatures features;
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int leaf1[4], leaf7[4];
+    __cpuidex(leaf1, 1, 0);
+    __cpuidex(leaf7, 7, 0);
+
+    // whether the OS saves the ymm and zmm registers on context switches
+    const bool osxsave = leaf1[2] & (1 << 27);
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool osAvx = (xcr0 & 0x06) == 0x06;
+    const bool osAvx512 = (xcr0 & 0xe6) == 0xe6;
+
+    features.sse41 = leaf1[2] & (1 << 19);
+    features.avx2 = osAvx && (leaf7[1] & (1 << 5));
+    features.avx512bw = osAvx512 &&
+      (leaf7[1] & (1 << 16)) && (leaf7[1] & (1 << 17)) && (leaf7[1] & (1 << 30)) && (leaf7[1] & (1 << 31)); // F, DQ, BW, VL
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    // these also check that the OS saves the registers
+    __builtin_cpu_init();
+    features.sse41 = __builtin_cpu_supports("sse4.1");
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.avx512bw =
+      __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+#endif
+
+    return features;
+  }
+};
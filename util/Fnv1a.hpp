@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// 64-bit FNV-1a hash, for cache keys and checksums (not for anything adversarial).
+// Values are hashed by their bytes, so only add types without padding.
+struct Fnv1a
+{
+  uint64_t value{0xcbf29ce484222325ull};
+
+  Fnv1a &add(const void *data, size_t size)
+  {
+    for (size_t i = 0; i < size; ++i)
+      value = (value ^ ((const uint8_t *)data)[i]) * 0x100000001b3ull;
+
+    return *this;
+  }
+
+  template<class T>
+  requires std::is_trivially_copyable_v<T>
+  Fnv1a &add(const T &x) {return add(&x, sizeof(x));}
+};
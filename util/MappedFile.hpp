@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "NoCopyNoMove.hpp"
+
+// A whole file mapped into memory as a private copy-on-write mapping:
+// the contents can be modified in place, but changes stay in this process and never reach the file.
+// note: use std::optional or std::unique_ptr to contain this if you want a replaceable object
+class MappedFile : NoCopyNoMove
+{
+public:
+  // throws std::runtime_error if the file can't be opened or mapped
+  explicit MappedFile(const std::filesystem::path &path)
+  {
+    #ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+      throw std::runtime_error("MappedFile: could not open " + path.string());
+
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+      CloseHandle(file);
+      throw std::runtime_error("MappedFile: could not get size of " + path.string());
+    }
+
+    numBytes = (size_t)fileSize.QuadPart;
+
+    if (numBytes != 0)
+    {
+      // the mapping and view keep the file open, so both handles can be closed right away
+      HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+      CloseHandle(file);
+
+      if (mapping == nullptr)
+        throw std::runtime_error("MappedFile: could not map " + path.string());
+
+      pointer = (std::byte *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+      CloseHandle(mapping);
+
+      if (pointer == nullptr)
+        throw std::runtime_error("MappedFile: could not map " + path.string());
+    }
+    else
+      CloseHandle(file);
+    #else
+    const int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+      throw std::runtime_error("MappedFile: could not open " + path.string());
+
+    struct stat fileStat{};
+
+    if (fstat(fd, &fileStat) != 0)
+    {
+      close(fd);
+      throw std::runtime_error("MappedFile: could not get size of " + path.string());
+    }
+
+    numBytes = (size_t)fileStat.st_size;
+
+    if (numBytes != 0)
+    {
+      // the mapping keeps the file open, so the descriptor can be closed right away
+      void *mapped = mmap(nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      close(fd);
+
+      if (mapped == MAP_FAILED)
+        throw std::runtime_error("MappedFile: could not map " + path.string());
+
+      pointer = (std::byte *)mapped;
+    }
+    else
+      close(fd);
+    #endif
+  }
+
+  ~MappedFile()
+  {
+    if (pointer == nullptr)
+      return;
+
+    #ifdef _WIN32
+    UnmapViewOfFile(pointer);
+    #else
+    munmap(pointer, numBytes);
+    #endif
+  }
+
+  // page-aligned; nullptr if the file is empty
+  [[nodiscard]] std::byte *
+  data() const {return pointer;}
+
+  [[nodiscard]] size_t
+  size() const {return numBytes;}
+
+private:
+  std::byte *pointer{};
+  size_t numBytes{};
+};
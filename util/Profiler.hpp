@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "NoCopyNoMove.hpp"
+
+// Scoped-zone profiler: PROFILE_ZONE("name") records the time from that line to the end of the enclosing scope.
+// Each thread records into its own ring buffer, so recording takes no locks; only the most recent
+// Profiler::eventsPerThread zones of each thread are kept.
+// Zones are only recorded if PROFILER is defined (see CMakeLists.txt); otherwise PROFILE_ZONE expands to nothing.
+// Zone names must be string literals (or otherwise outlive the profiler).
+
+namespace profiler
+{
+  struct ZoneEvent
+  {
+    const char *name;
+    int64_t begin, end; // nanoseconds of std::chrono::steady_clock
+  };
+
+  struct ZoneStats
+  {
+    std::string name;
+    size_t count;
+    double p50Millis, p99Millis, maxMillis;
+  };
+
+  class Profiler : NoCopyNoMove
+  {
+  public:
+    static constexpr size_t eventsPerThread = 1 << 14; // must be a power of 2
+
+    static Profiler &instance()
+    {
+      static Profiler profiler;
+      return profiler;
+    }
+
+    static int64_t now() {return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();}
+
+    void record(const char *name, int64_t begin, int64_t end)
+    {
+      ThreadEvents &events = threadEvents();
+      const uint64_t count = events.count.load(std::memory_order_relaxed); // only this thread writes it
+      events.ring[count & (eventsPerThread - 1)] = {.name = name, .begin = begin, .end = end};
+      events.count.store(count + 1, std::memory_order_release);
+    }
+
+    // The functions below read every thread's ring buffer, so call them when no other thread is recording
+    // (e.g. between frames, when the worker pool is idle).
+
+    // Percentiles of the duration of each zone name over the zones still in the ring buffers, sorted by name.
+    [[nodiscard]]
+    std::vector<ZoneStats>
+    stats() const
+    {
+      std::map<std::string, std::vector<int64_t>> durations;
+
+      forEachEvent([&](unsigned, const ZoneEvent &event) {durations[event.name].push_back(event.end - event.begin);});
+
+      std::vector<ZoneStats> result;
+
+      for (auto &[name, d]: durations)
+      {
+        auto percentile = [&](double p)
+        {
+          auto nth = d.begin() + std::min(d.size() - 1, size_t(p * (double)d.size()));
+          std::nth_element(d.begin(), nth, d.end());
+          return (double)*nth * 1e-6;
+        };
+
+        result.push_back(ZoneStats{
+          .name = name, .count = d.size(),
+          .p50Millis = percentile(0.5), .p99Millis = percentile(0.99), .maxMillis = (double)*std::max_element(d.begin(), d.end()) * 1e-6});
+      }
+
+      return result;
+    }
+
+    // Writes the zones still in the ring buffers in Chrome's trace event format (load in chrome://tracing or Perfetto).
+    // throws std::runtime_error on failure
+    void writeChromeTrace(const std::filesystem::path &path) const
+    {
+      std::ofstream file{path};
+
+      if (!file)
+        throw std::runtime_error("Profiler: could not create " + path.string());
+
+      // times are relative to the earliest zone
+      int64_t origin = INT64_MAX;
+      forEachEvent([&](unsigned, const ZoneEvent &event) {origin = std::min(origin, event.begin);});
+
+      file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+      const char *separator = "\n";
+
+      forEachEvent(
+        [&](unsigned thread, const ZoneEvent &event)
+        {
+          file
+            << separator << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread
+            << ", \"ts\": " << (double)(event.begin - origin) * 1e-3 << ", \"dur\": " << (double)(event.end - event.begin) * 1e-3 << "}";
+          separator = ",\n";
+        });
+
+      file << "\n]}\n";
+
+      if (!file.flush())
+        throw std::runtime_error("Profiler: could not write " + path.string());
+    }
+
+  private:
+    struct ThreadEvents
+    {
+      std::unique_ptr<ZoneEvent[]> ring{std::make_unique<ZoneEvent[]>(eventsPerThread)};
+      std::atomic<uint64_t> count{0};
+    };
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadEvents>> threads; // guarded by mutex; outlive their threads so zones can be written after they exit
+
+    Profiler() = default;
+
+    ThreadEvents &threadEvents()
+    {
+      thread_local ThreadEvents *events = [this]
+      {
+        std::lock_guard lock{mutex};
+        return threads.emplace_back(std::make_unique<ThreadEvents>()).get();
+      }();
+
+      return *events;
+    }
+
+    void forEachEvent(auto &&f) const
+    {
+      std::lock_guard lock{mutex};
+
+      for (unsigned thread = 0; thread < (unsigned)threads.size(); ++thread)
+      {
+        const ThreadEvents &events = *threads[thread];
+        const uint64_t count = events.count.load(std::memory_order_acquire);
+
+        for (uint64_t i = count - std::min<uint64_t>(count, eventsPerThread); i < count; ++i)
+          f(thread, events.ring[i & (eventsPerThread - 1)]);
+      }
+    }
+  };
+
+  class Zone : NoCopyNoMove
+  {
+  public:
+    explicit Zone(const char *name) : name{name}, begin{Profiler::now()} {}
+    ~Zone() {Profiler::instance().record(name, begin, Profiler::now());}
+
+  private:
+    const char *const name;
+    const int64_t begin;
+  };
+}
+
+#ifdef PROFILER
+  #define PROFILER_CONCAT_(a, b) a##b
+  #define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+  #define PROFILE_ZONE(name) const profiler::Zone PROFILER_CONCAT(profileZone, __LINE__){name}
+#else
+  #define PROFILE_ZONE(name) ((void)0)
+#endif
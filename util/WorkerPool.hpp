@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "function_traits.hpp"
+#include "NoCopyNoMove.hpp"
+
+// Fixed set of worker threads for data-parallel loops.
+// The calling thread participates in forEach, so WorkerPool{1} has no worker threads and simply runs in-line.
+// forEach is not reentrant: call it from one thread at a time.
+class WorkerPool : NoCopyNoMove
+{
+public:
+  // numThreads includes the calling thread; 0 means one per hardware thread
+  explicit WorkerPool(unsigned numThreads = 0)
+  {
+    if (numThreads == 0)
+      numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 1; i < numThreads; ++i)
+      workers.emplace_back([this] {workerLoop();});
+  }
+
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard lock{mutex};
+      quit = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &worker: workers)
+      worker.join();
+  }
+
+  [[nodiscard]] unsigned
+  size() const {return (unsigned)workers.size() + 1;}
+
+  // Calls f(i) for every i in [0, n), distributing indices over all threads, and returns when all calls have returned.
+  void forEach(size_t n, Function<void(size_t)> auto &&f)
+  {
+    if (n == 0)
+      return;
+
+    if (workers.empty() || n == 1)
+    {
+      for (size_t i = 0; i < n; ++i)
+        f(i);
+      return;
+    }
+
+    using F = std::remove_reference_t<decltype(f)>;
+
+    const Job thisJob{.call = [](void *context, size_t i) {(*(F *)context)(i);}, .context = (void *)&f, .n = n};
+
+    {
+      std::unique_lock lock{mutex};
+      done.wait(lock, [&] {return activeWorkers == 0;}); // a late worker may still be looking at the previous job
+      job = thisJob;
+      next = 0;
+      remaining = n;
+      ++generation;
+    }
+    wake.notify_all();
+
+    runJob(thisJob);
+
+    std::unique_lock lock{mutex};
+    done.wait(lock, [&] {return remaining == 0 && activeWorkers == 0;});
+  }
+
+private:
+  struct Job
+  {
+    void (*call)(void *context, size_t i);
+    void *context;
+    size_t n;
+  };
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake, done;
+  Job job{};
+  std::atomic<size_t> next{0};
+  size_t remaining{0}; // guarded by mutex
+  unsigned activeWorkers{0}; // guarded by mutex
+  uint64_t generation{0}; // guarded by mutex
+  bool quit{false}; // guarded by mutex
+
+  void runJob(const Job &thisJob)
+  {
+    size_t completed = 0;
+
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < thisJob.n; ++completed)
+      thisJob.call(thisJob.context, i);
+
+    if (completed != 0)
+    {
+      std::lock_guard lock{mutex};
+      remaining -= completed;
+    }
+  }
+
+  void workerLoop()
+  {
+    uint64_t lastGeneration = 0;
+
+    for (;;)
+    {
+      Job thisJob;
+
+      {
+        std::unique_lock lock{mutex};
+        wake.wait(lock, [&] {return quit || generation != lastGeneration;});
+
+        if (quit)
+          return;
+
+        lastGeneration = generation;
+        thisJob = job;
+        ++activeWorkers;
+      }
+
+      runJob(thisJob);
+
+      {
+        std::lock_guard lock{mutex};
+        --activeWorkers;
+      }
+      done.notify_all();
+    }
+  }
+};
@@ -2,19 +2,72 @@
 
 #include <cstdint>
 
-#ifdef __AVX2__
+// Compiled for each instruction set as part of the drawing kernels (see src/drawing/kernels/Kernels.hpp), which is
+// how the rest of the program calls these.
+
+#if defined(__AVX512BW__)
+
+#include <immintrin.h>
+
+static void fillFast(uint32_t *dst, size_t n, uint32_t val)
+{
+  // the AVX version with 64 byte streaming stores, and masked stores for the head and tail
+  const __m512i val16 = _mm512_set1_epi32((int)val);
+
+  // unaligned head: elements up to the next 64 byte boundary
+  size_t headN = (size_t)(-(uintptr_t)dst & 63) / sizeof(uint32_t);
+  headN = headN < n ? headN : n;
+  _mm512_mask_storeu_epi32(dst, (__mmask16)((1u << headN) - 1), val16);
+  dst += headN;
+  n -= headN;
+
+  // aligned body
+  constexpr size_t simdSize = 16;
+  const size_t simdN = n - n % simdSize;
+
+  for (size_t i = 0; i < simdN; i += simdSize)
+    _mm512_stream_si512((__m512i *)(dst + i), val16);
+
+  // too-small tail
+  _mm512_mask_storeu_epi32(dst + simdN, (__mmask16)((1u << (n - simdN)) - 1), val16);
+}
+
+static void fillFast(int16_t *dst, size_t n, int16_t val)
+{
+  // the AVX version with 64 byte streaming stores, and masked stores for the head and tail
+  const __m512i val32 = _mm512_set1_epi16(val);
+
+  // unaligned head: elements up to the next 64 byte boundary
+  size_t headN = (size_t)(-(uintptr_t)dst & 63) / sizeof(uint16_t);
+  headN = headN < n ? headN : n;
+  _mm512_mask_storeu_epi16(dst, (__mmask32)((1ull << headN) - 1), val32);
+  dst += headN;
+  n -= headN;
+
+  // aligned body
+  constexpr size_t simdSize = 32;
+  const size_t simdN = n - n % simdSize;
+
+  for (size_t i = 0; i < simdN; i += simdSize)
+    _mm512_stream_si512((__m512i *)(dst + i), val32);
+
+  // too-small tail
+  _mm512_mask_storeu_epi16(dst + simdN, (__mmask32)((1ull << (n - simdN)) - 1), val32);
+}
+
+#elif defined(__AVX2__)
 
 #include <immintrin.h>
 
-void fillFast(uint32_t *dst, size_t n, uint32_t val)
+static void fillFast(uint32_t *dst, size_t n, uint32_t val)
 {
   // AVX version which uses streaming store which tells the CPU to bypass the write cache.
   // For some reason this is dramatically faster than using non-streaming store.
 
   // unaligned head
   {
-    // align size to 32 bytes
-    size_t headN = (size_t)((uintptr_t)dst & 31) / sizeof(uint32_t);
+    // elements up to the next 32 byte boundary
+    size_t headN = (size_t)(-(uintptr_t)dst & 31) / sizeof(uint32_t);
     headN = headN < n ? headN : n;
 
     for (size_t i = 0; i < headN; ++i)
@@ -40,15 +93,15 @@ void fillFast(uint32_t *dst, size_t n, uint32_t val)
     _mm_stream_si32((int *)(dst + i), val);
 }
 
-void fillFast(int16_t *dst, size_t n, int16_t val)
+static void fillFast(int16_t *dst, size_t n, int16_t val)
 {
   // AVX version which uses streaming store which tells the CPU to bypass the write cache.
   // For some reason this is dramatically faster than using non-streaming store.
 
   // unaligned head
   {
-    // align size to 32 bytes
-    size_t headN = (size_t)((uintptr_t)dst & 31) / sizeof(uint16_t);
+    // elements up to the next 32 byte boundary
+    size_t headN = (size_t)(-(uintptr_t)dst & 31) / sizeof(uint16_t);
     headN = headN < n ? headN : n;
 
     for (size_t i = 0; i < headN; ++i)
@@ -74,16 +127,119 @@ void fillFast(int16_t *dst, size_t n, int16_t val)
     dst[i] = val;
 }
 
-#else // not __AVX2__
+#elif defined(__SSE4_1__)
+
+#include <immintrin.h>
+
+static void fillFast(uint32_t *dst, size_t n, uint32_t val)
+{
+  // the SSE4.1 version with 16 byte stores
+
+  // unaligned head
+  size_t headN = (size_t)(-(uintptr_t)dst & 15) / sizeof(uint32_t);
+  headN = headN < n ? headN : n;
+
+  for (size_t i = 0; i < headN; ++i)
+    _mm_stream_si32((int *)(dst + i), val);
+
+  dst += headN;
+  n -= headN;
+
+  // aligned body
+  constexpr size_t simdSize = 4;
+  const size_t simdN = n - n % simdSize;
+
+  __m128i val4 = _mm_set1_epi32(val);
+  for (size_t i = 0; i < simdN; i += simdSize)
+    _mm_stream_si128((__m128i *)(dst + i), val4);
+
+  // too-small tail
+  for (size_t i = simdN; i < n; ++i)
+    _mm_stream_si32((int *)(dst + i), val);
+}
+
+static void fillFast(int16_t *dst, size_t n, int16_t val)
+{
+  // the SSE4.1 version with 16 byte stores
+
+  // unaligned head
+  size_t headN = (size_t)(-(uintptr_t)dst & 15) / sizeof(uint16_t);
+  headN = headN < n ? headN : n;
+
+  for (size_t i = 0; i < headN; ++i)
+    dst[i] = val;
+
+  dst += headN;
+  n -= headN;
+
+  // aligned body
+  constexpr size_t simdSize = 8;
+  const size_t simdN = n - n % simdSize;
+
+  __m128i val8 = _mm_set1_epi16(val);
+  for (size_t i = 0; i < simdN; i += simdSize)
+    _mm_stream_si128((__m128i *)(dst + i), val8);
+
+  // too-small tail
+  for (size_t i = simdN; i < n; ++i)
+    dst[i] = val;
+}
+
+#elif defined(DRAWING_KERNELS_NEON)
+
+#include <arm_neon.h>
+
+static void fillFast(uint32_t *dst, size_t n, uint32_t val)
+{
+  // NEON version with 64 bytes per iteration. ARM has no streaming stores to bypass the cache (STNP is only a hint),
+  // and unaligned stores are as fast as aligned ones, so there is no head.
+  constexpr size_t simdSize = 16;
+  const size_t simdN = n - n % simdSize;
+
+  const uint32x4_t val4 = vdupq_n_u32(val);
+  for (size_t i = 0; i < simdN; i += simdSize)
+  {
+    vst1q_u32(dst + i, val4);
+    vst1q_u32(dst + i + 4, val4);
+    vst1q_u32(dst + i + 8, val4);
+    vst1q_u32(dst + i + 12, val4);
+  }
+
+  // too-small tail
+  for (size_t i = simdN; i < n; ++i)
+    dst[i] = val;
+}
+
+static void fillFast(int16_t *dst, size_t n, int16_t val)
+{
+  // the same as the uint32_t version
+  constexpr size_t simdSize = 32;
+  const size_t simdN = n - n % simdSize;
+
+  const int16x8_t val8 = vdupq_n_s16(val);
+  for (size_t i = 0; i < simdN; i += simdSize)
+  {
+    vst1q_s16(dst + i, val8);
+    vst1q_s16(dst + i + 8, val8);
+    vst1q_s16(dst + i + 16, val8);
+    vst1q_s16(dst + i + 24, val8);
+  }
+
+  // too-small tail
+  for (size_t i = simdN; i < n; ++i)
+    dst[i] = val;
+}
+
+#else // no SIMD
 
 #include <algorithm>
 
-void fillFast(uint32_t *dst, size_t n, uint32_t val)
+static void fillFast(uint32_t *dst, size_t n, uint32_t val)
 {
   std::fill_n(dst, n, val);
 }
 
-void fillFast(int16_t *dst, size_t n, int16_t val)
+static void fillFast(int16_t *dst, size_t n, int16_t val)
 {
   std::fill_n(dst, n, val);
 }
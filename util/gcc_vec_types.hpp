@@ -1,7 +1,8 @@
 #pragma once
 
-#if defined(__GCC__) || defined(__clang__)
+#if defined(__GNUC__) || defined(__clang__)
 
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 
@@ -39,17 +40,29 @@ template<>
 struct uint_promotion<uint32_t> { using bigger = uint64_t; };
 
 //----------------------------------------------------------------------------------------------------------------------
-// gcc_vector_traits
+// gcc_vector
 
-template<class V>
-struct gcc_vector_traits;
+// the vector of N Ts (through a struct: GCC ignores vector_size on a dependent type in an alias template)
+template<class T, size_t N>
+struct gcc_vector_of
+{
+  typedef T type __attribute__ ((vector_size(N * sizeof(T))));
+};
+
+template<class T, size_t N>
+using gcc_vector = typename gcc_vector_of<T, N>::type;
 
-template<class T, size_t B>
-struct gcc_vector_traits<T __attribute__ ((vector_size(B)))>
+//----------------------------------------------------------------------------------------------------------------------
+// gcc_vector_traits
+
+// (not a partial specialization on vector_size(B), which GCC can't deduce)
+template<GccVector V>
+struct gcc_vector_traits
 {
-  using base_type = T;
-  using bigger_type = typename uint_promotion<T>::bigger __attribute__ ((vector_size(B)));
-  static constexpr size_t num_bytes = B;
+  using base_type = std::remove_cvref_t<decltype(std::declval<V>()[0])>;
+  static constexpr size_t size = sizeof(V) / sizeof(base_type);
+  using bigger_type = gcc_vector<typename uint_promotion<base_type>::bigger, size>;
+  static constexpr size_t num_bytes = sizeof(V);
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -61,6 +74,31 @@ using uint8_32 = uint8_t __attribute__ ((vector_size(32))); // __m256i
 using uint16_8 = uint16_t __attribute__ ((vector_size(16))); // __m128i
 using uint16_16 = uint16_t __attribute__ ((vector_size(32))); // __m256i
 
+//----------------------------------------------------------------------------------------------------------------------
+// native_vector_bytes
+
+// the size of the vector registers every CPU the program runs on has: SSE2, which every x86-64 CPU has, or NEON. Wider
+// ones are only used by the drawing kernels, which are compiled for each instruction set and chosen at run-time (see
+// src/drawing/kernels/Kernels.hpp), so this doesn't depend on the compiler's target options.
+constexpr size_t native_vector_bytes = 16;
+
+//----------------------------------------------------------------------------------------------------------------------
+// any_lane
+
+// whether any lane of v is nonzero, e.g. of the result of a comparison
+template<GccVector V>
+bool any_lane(V v)
+{
+  using words = gcc_vector<uint64_t, sizeof(V) / sizeof(uint64_t)>;
+  const words w = (words)v;
+
+  uint64_t any = 0;
+  for (size_t i = 0; i < sizeof(V) / sizeof(uint64_t); ++i)
+    any |= w[i];
+
+  return any != 0;
+}
+
 #else
-#pragma warning(__FILE__ " was included but __GCC__ or __clang__ are not defined")
+#pragma warning(__FILE__ " was included but neither __GNUC__ nor __clang__ is defined")
 #endif